@@ -0,0 +1,74 @@
+// Benchmarks for building and tearing down node based containers with
+// std::allocator against nwacc::pool_allocator.
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "linked_list.h"
+#include "node_pool.h"
+#include "tree.h"
+
+namespace
+{
+	std::vector<int> shuffled_keys(std::size_t n)
+	{
+		std::vector<int> keys(n);
+		std::iota(keys.begin(), keys.end(), 0);
+		std::shuffle(keys.begin(), keys.end(), std::mt19937{ 42 });
+		return keys;
+	}
+
+	template <typename Tree>
+	void tree_build_teardown(const std::string &name, const std::vector<int> &keys)
+	{
+		bench::stopwatch timer;
+		double build_seconds;
+		{
+			Tree bst;
+			for (auto key : keys)
+			{
+				bst.insert(key);
+			}
+			build_seconds = timer.seconds();
+			timer.restart();
+		}
+		auto teardown_seconds = timer.seconds();
+		bench::report(name + " build", keys.size(), keys.size(), build_seconds);
+		bench::report(name + " teardown", keys.size(), keys.size(), teardown_seconds);
+	}
+
+	template <typename List>
+	void list_build_teardown(const std::string &name, std::size_t n)
+	{
+		bench::stopwatch timer;
+		double build_seconds;
+		{
+			List list;
+			for (std::size_t value = 0; value < n; value++)
+			{
+				list.push_back(static_cast<int>(value));
+			}
+			build_seconds = timer.seconds();
+			timer.restart();
+		}
+		auto teardown_seconds = timer.seconds();
+		bench::report(name + " build", n, n, build_seconds);
+		bench::report(name + " teardown", n, n, teardown_seconds);
+	}
+}
+
+BENCHMARK(allocator_build_teardown)
+{
+	for (auto n : bench::sizes(4, 6))
+	{
+		auto keys = shuffled_keys(n);
+		tree_build_teardown<nwacc::tree<int, nwacc::avl>>("tree<avl, std::allocator>", keys);
+		tree_build_teardown<nwacc::tree<int, nwacc::avl, nwacc::pool_allocator<int>>>("tree<avl, pool_allocator>", keys);
+		list_build_teardown<nwacc::linked_list<int>>("linked_list<std::allocator>", n);
+		list_build_teardown<nwacc::linked_list<int, nwacc::pool_allocator<int>>>("linked_list<pool_allocator>", n);
+	}
+}
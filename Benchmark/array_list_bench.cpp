@@ -0,0 +1,110 @@
+// Benchmarks for appending to array_list against std::vector: growing one
+// big list of ints or strings from empty and after reserve, and building
+// many short lists, where an inline buffer avoids the heap altogether.
+// Each line also reports the allocations made per element; array_list
+// takes its memory from malloc rather than operator new, so only the
+// strings it copies show up in its counts.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "array_list.h"
+#include "bench.h"
+
+namespace
+{
+	const std::size_t kShortLength = 8;
+
+	template <typename Operation>
+	void measure(const std::string &name, std::size_t n, Operation operation)
+	{
+		auto allocations = bench::allocations();
+		bench::stopwatch timer;
+		operation();
+		auto seconds = timer.seconds();
+		bench::report(name, n, n, seconds, bench::allocations() - allocations);
+	}
+
+	std::vector<std::string> make_strings(std::size_t n)
+	{
+		// long enough that every string has its own heap buffer.
+		std::vector<std::string> values;
+		values.reserve(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			values.push_back("value number " + std::to_string(index) + " of the benchmark");
+		}
+		return values;
+	}
+
+	template <typename List, typename Value>
+	void append(const std::string &name, const std::vector<Value> &values, bool reserve)
+	{
+		auto fill = [&] {
+			List list;
+			if (reserve)
+			{
+				list.reserve(static_cast<int>(values.size()));
+			} // else, let it grow, do_nothing();
+
+			for (const auto &value : values)
+			{
+				list.push_back(value);
+			}
+			bench::consume(static_cast<std::size_t>(list.size()));
+		};
+
+		// once untimed, so whichever runs first does not pay to fault in
+		// fresh heap pages.
+		fill();
+		measure(name, values.size(), fill);
+	}
+
+	template <typename List>
+	void short_lists(const std::string &name, std::size_t n)
+	{
+		measure(name, n, [&] {
+			for (std::size_t done = 0; done < n; done += kShortLength)
+			{
+				List list;
+				for (std::size_t index = 0; index < kShortLength; index++)
+				{
+					list.push_back(static_cast<int>(done + index));
+				}
+				bench::consume(static_cast<std::size_t>(list.size()));
+			}
+		});
+	}
+}
+
+BENCHMARK(array_list_push_back)
+{
+	for (auto n : bench::sizes(4, 7))
+	{
+		std::vector<int> ints(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			ints[index] = static_cast<int>(index);
+		}
+		append<nwacc::array_list<int>>("array_list<int> push_back", ints, false);
+		append<std::vector<int>>("std::vector<int> push_back", ints, false);
+		append<nwacc::array_list<int>>("array_list<int> reserve, push_back", ints, true);
+		append<std::vector<int>>("std::vector<int> reserve, push_back", ints, true);
+
+		if (n <= 1000000)
+		{
+			auto strings = make_strings(n);
+			append<nwacc::array_list<std::string>>("array_list<string> push_back", strings, false);
+			append<std::vector<std::string>>("std::vector<string> push_back", strings, false);
+		}
+		else
+		{
+			bench::skip("array_list<string> push_back", n, "too much memory for the strings");
+		}
+
+		short_lists<nwacc::array_list<int>>("array_list<int> lists of 8", n);
+		short_lists<nwacc::array_list<int, 8>>("array_list<int, 8> lists of 8", n);
+		short_lists<std::vector<int>>("std::vector<int> lists of 8", n);
+	}
+}
@@ -0,0 +1,67 @@
+// Benchmarks for the batched contains_many lookups against calling
+// contains once per key. Build with -mavx2 (or /arch:AVX2) to include the
+// vectorized flat_tree path.
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "flat_tree.h"
+#include "tree.h"
+
+namespace
+{
+	const std::size_t kLookups = 1000000;
+
+	template <typename Set>
+	void time_batch(const std::string &name, const Set &set, const std::vector<int> &keys, std::size_t n)
+	{
+		std::unique_ptr<bool[]> found(new bool[keys.size()]);
+		bench::stopwatch timer;
+		for (std::size_t index = 0; index < keys.size(); index++)
+		{
+			found[index] = set.contains(keys[index]);
+		}
+		bench::report(name + "::contains loop", n, keys.size(), timer.seconds());
+		bench::consume(std::count(found.get(), found.get() + keys.size(), true));
+
+		timer.restart();
+		set.contains_many(keys.data(), keys.size(), found.get());
+		bench::report(name + "::contains_many", n, keys.size(), timer.seconds());
+		bench::consume(std::count(found.get(), found.get() + keys.size(), true));
+	}
+}
+
+BENCHMARK(batch_lookup)
+{
+	for (auto n : bench::sizes(5, 8))
+	{
+		std::vector<int> stored(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			stored[index] = static_cast<int>(2 * index);
+		}
+		std::mt19937 generator{ 42 };
+		std::shuffle(stored.begin(), stored.end(), generator);
+
+		nwacc::tree<int, nwacc::avl> bst;
+		for (auto key : stored)
+		{
+			bst.insert(key);
+		}
+		auto snapshot = bst.freeze();
+
+		std::uniform_int_distribution<int> distribution(0, static_cast<int>(2 * n));
+		std::vector<int> keys(kLookups);
+		for (auto &key : keys)
+		{
+			key = distribution(generator);
+		}
+
+		time_batch("tree<avl>", bst, keys, n);
+		time_batch("flat_tree", snapshot, keys, n);
+	}
+}
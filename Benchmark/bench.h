@@ -0,0 +1,133 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+	using benchmark_function = void (*)();
+
+	/**
+	 * Registers a benchmark under a name so main can find and run it.
+	 * Use the BENCHMARK macro rather than constructing one of these.
+	 */
+	struct registration
+	{
+		registration(const char *name, benchmark_function function);
+	};
+
+	/**
+	 * Times a region of code with the steady clock. The clock starts
+	 * when the stopwatch is created and again on every restart.
+	 */
+	class stopwatch
+	{
+	public:
+		stopwatch() : start{ std::chrono::steady_clock::now() } {}
+
+		void restart()
+		{
+			this->start = std::chrono::steady_clock::now();
+		}
+
+		double seconds() const
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+		}
+
+	private:
+		std::chrono::steady_clock::time_point start;
+	};
+
+	/**
+	 * Return the powers of ten from 10^low to 10^high, dropping any that
+	 * are larger than the --max size given on the command line.
+	 */
+	std::vector<std::size_t> sizes(int low, int high);
+
+	/**
+	 * Return the thread counts to scale across: 1, 2, 4, ... up to the
+	 * --threads given on the command line (the hardware concurrency by
+	 * default), always ending on that maximum.
+	 */
+	std::vector<int> thread_counts();
+
+	/**
+	 * Print one result line: the operation, the input size, the time per
+	 * operation and the throughput.
+	 */
+	void report(const std::string &name, std::size_t n, std::size_t operations, double seconds);
+
+	/**
+	 * Print one result line as above, followed by the allocations made
+	 * per operation and the peak resident set size of the process so far.
+	 */
+	void report(const std::string &name, std::size_t n, std::size_t operations, double seconds, std::size_t allocations);
+
+	/**
+	 * Print a line for a measurement that was deliberately not run.
+	 */
+	void skip(const std::string &name, std::size_t n, const std::string &reason);
+
+	/**
+	 * Fold a value into a global sink so the optimizer cannot discard
+	 * the work that produced it.
+	 */
+	void consume(std::size_t value);
+
+	/**
+	 * Return the number of calls to operator new made so far. Take the
+	 * difference across a region to count the allocations it made.
+	 */
+	std::size_t allocations();
+
+	/**
+	 * Return the number of bytes currently allocated with operator new,
+	 * not counting the allocator's own overhead.
+	 */
+	std::size_t allocated_bytes();
+
+	/**
+	 * Return the most memory the process has had resident at once, in
+	 * bytes, or 0 where the platform cannot tell us.
+	 */
+	std::size_t peak_rss();
+
+	/**
+	 * The orders keys can arrive in: uniformly random, ascending,
+	 * descending, skewed so a few keys repeat most of the time (Zipf with
+	 * an exponent of 0.99, the popular keys scattered across the range),
+	 * and in tight runs around random centers.
+	 */
+	enum class distribution
+	{
+		uniform,
+		sorted,
+		reverse,
+		zipfian,
+		clustered
+	};
+
+	/**
+	 * Return every distribution, in the order above.
+	 */
+	std::vector<distribution> distributions();
+
+	std::string to_string(distribution keys);
+
+	/**
+	 * Return n non-negative keys drawn from the distribution. The sorted
+	 * and reverse keys are 0 to n - 1; the others may repeat.
+	 */
+	std::vector<int> make_keys(distribution keys, std::size_t n, unsigned seed = 42);
+}
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static const bench::registration name##_registration{ #name, name }; \
+	static void name()
+
+#endif // BENCH_H_
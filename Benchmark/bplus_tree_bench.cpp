@@ -0,0 +1,123 @@
+// Benchmarks for bplus_tree against tree<avl> at 10^5 to 10^8 keys: the
+// memory each holds per key after a bulk load, inserting and removing
+// keys one at a time, looking keys up, and scanning everything or a
+// range. The B+ tree is run at a small fanout and at the default, which
+// fills about eight cache lines a node. 10^8 keys need --max=100000000
+// and several gigabytes.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "bplus_tree.h"
+#include "tree.h"
+
+namespace
+{
+	// lookups and inserts one at a time stop here, to keep the run short.
+	const std::size_t kMaxQueries = 1000000;
+	const std::size_t kMaxOneAtATime = 10000000;
+	const std::size_t kRangeScans = 1000;
+	const int kRangeWidth = 1000;
+
+	template <typename Set, typename Build>
+	void run(const std::string &label, const std::vector<int> &sorted, const std::vector<int> &shuffled, Build build)
+	{
+		const auto n = sorted.size();
+		{
+			// once untimed, so the allocator has settled after freeing the
+			// last container's nodes.
+			Set warm_up = build();
+			bench::consume(warm_up.size());
+		}
+
+		auto bytes = bench::allocated_bytes();
+		bench::stopwatch timer;
+		Set set = build();
+		bench::report(label + " from_sorted", n, n, timer.seconds());
+		std::cout << "    " << static_cast<double>(bench::allocated_bytes() - bytes) / n << " bytes per key\n";
+
+		auto queries = std::min(n, kMaxQueries);
+		timer.restart();
+		std::size_t found = 0;
+		for (std::size_t index = 0; index < queries; index++)
+		{
+			// the odd keys are missing, so half the lookups fail.
+			found += set.contains(shuffled[index] | (static_cast<int>(index) & 1));
+		}
+		bench::report(label + " contains", n, queries, timer.seconds());
+		bench::consume(found);
+
+		timer.restart();
+		std::size_t sum = 0;
+		for (auto key : set)
+		{
+			sum += static_cast<std::size_t>(key);
+		}
+		bench::report(label + " scan", n, n, timer.seconds());
+
+		std::mt19937 random{ 5 };
+		std::size_t visited = 0;
+		timer.restart();
+		for (std::size_t scan = 0; scan < kRangeScans; scan++)
+		{
+			auto low = static_cast<int>(random() % (2 * n));
+			set.for_each_in_range(low, low + 2 * kRangeWidth, [&](int key) {
+				sum += static_cast<std::size_t>(key);
+				visited++;
+			});
+		}
+		bench::report(label + " for_each_in_range", n, visited, timer.seconds());
+		bench::consume(sum);
+
+		if (n > kMaxOneAtATime)
+		{
+			bench::skip(label + " insert", n, "one at a time takes too long");
+			return;
+		} // else, time the updates.
+
+		timer.restart();
+		for (std::size_t index = 0; index < queries; index++)
+		{
+			set.insert(shuffled[index] | 1);
+		}
+		bench::report(label + " insert", n, queries, timer.seconds());
+
+		timer.restart();
+		for (std::size_t index = 0; index < queries; index++)
+		{
+			set.remove(shuffled[index]);
+		}
+		bench::report(label + " remove", n, queries, timer.seconds());
+	}
+}
+
+BENCHMARK(bplus_tree)
+{
+	for (auto n : bench::sizes(5, 8))
+	{
+		// the even numbers below 2n, so there are gaps to miss and fill.
+		std::vector<int> sorted(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			sorted[index] = static_cast<int>(2 * index);
+		}
+		auto shuffled = sorted;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ 42 });
+
+		run<nwacc::tree<int, nwacc::avl>>("tree<avl>", sorted, shuffled, [&]() {
+			return nwacc::tree<int, nwacc::avl>::from_sorted(sorted.begin(), sorted.end());
+		});
+		run<nwacc::bplus_tree<int, 16>>("bplus_tree<16>", sorted, shuffled, [&]() {
+			return nwacc::bplus_tree<int, 16>::from_sorted(sorted.begin(), sorted.end());
+		});
+		run<nwacc::bplus_tree<int>>("bplus_tree<" + std::to_string(nwacc::bplus_fanout<int>()) + ">", sorted, shuffled, [&]() {
+			return nwacc::bplus_tree<int>::from_sorted(sorted.begin(), sorted.end());
+		});
+	}
+}
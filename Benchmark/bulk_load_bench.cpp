@@ -0,0 +1,65 @@
+// Benchmarks for rebuilding a tree at startup: inserting keys one at a
+// time against the linear tree::from_sorted bulk load and the sorting
+// tree::from_unsorted path.
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "node_pool.h"
+#include "tree.h"
+
+namespace
+{
+	using avl_tree = nwacc::tree<int, nwacc::avl>;
+	using pooled_tree = nwacc::tree<int, nwacc::avl, nwacc::pool_allocator<int>>;
+
+	template <typename Build>
+	void time_build(const std::string &name, std::size_t n, Build build)
+	{
+		bench::stopwatch timer;
+		auto bst = build();
+		bench::report(name, n, n, timer.seconds());
+		bench::consume(bst.size());
+	}
+}
+
+BENCHMARK(bulk_load)
+{
+	for (auto n : bench::sizes(5, 7))
+	{
+		std::vector<int> sorted(n);
+		std::iota(sorted.begin(), sorted.end(), 0);
+		auto shuffled = sorted;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ 42 });
+
+		time_build("insert one at a time, shuffled", n, [&]() {
+			avl_tree bst;
+			for (auto key : shuffled)
+			{
+				bst.insert(key);
+			}
+			return bst;
+		});
+		time_build("insert one at a time, sorted", n, [&]() {
+			avl_tree bst;
+			for (auto key : sorted)
+			{
+				bst.insert(key);
+			}
+			return bst;
+		});
+		time_build("tree::from_sorted", n, [&]() {
+			return avl_tree::from_sorted(sorted.begin(), sorted.end());
+		});
+		time_build("tree::from_sorted, pool_allocator", n, [&]() {
+			return pooled_tree::from_sorted(sorted.begin(), sorted.end());
+		});
+		time_build("tree::from_unsorted", n, [&]() {
+			return avl_tree::from_unsorted(shuffled.begin(), shuffled.end());
+		});
+	}
+}
@@ -0,0 +1,110 @@
+// Benchmarks for compact_tree against tree<avl> at 10^5 to 10^8 keys: the
+// memory each holds per key, built in bulk and one key at a time, and how
+// long a lookup takes once the tree is far bigger than the caches. 10^8
+// keys need --max=100000000 and several gigabytes.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "compact_tree.h"
+#include "tree.h"
+
+namespace
+{
+	// lookups stop here, to keep the run short.
+	const std::size_t kMaxQueries = 1000000;
+	const std::size_t kMaxOneAtATime = 10000000;
+
+	template <typename Set, typename Build>
+	void run(const std::string &label, const std::vector<int> &sorted, const std::vector<int> &shuffled, Build build)
+	{
+		const auto n = sorted.size();
+		{
+			// once untimed, so the allocator has settled after freeing the
+			// last container's nodes.
+			Set warm_up = build();
+			bench::consume(warm_up.size());
+		}
+
+		auto queries = std::min(n, kMaxQueries);
+		std::size_t found = 0;
+		bench::stopwatch timer;
+		{
+			auto bytes = bench::allocated_bytes();
+			timer.restart();
+			Set set = build();
+			bench::report(label + " from_sorted", n, n, timer.seconds());
+			std::cout << "    " << static_cast<double>(bench::allocated_bytes() - bytes) / n << " bytes per key\n";
+
+			timer.restart();
+			for (std::size_t index = 0; index < queries; index++)
+			{
+				// the odd keys are missing, so half the lookups fail.
+				found += set.contains(shuffled[index] | (static_cast<int>(index) & 1));
+			}
+			bench::report(label + " contains", n, queries, timer.seconds());
+			bench::consume(found);
+
+			timer.restart();
+			std::size_t sum = 0;
+			for (auto key : set)
+			{
+				sum += static_cast<std::size_t>(key);
+			}
+			bench::report(label + " scan", n, n, timer.seconds());
+			bench::consume(sum);
+		}
+
+		if (n > kMaxOneAtATime)
+		{
+			bench::skip(label + " insert", n, "one at a time takes too long");
+			return;
+		} // else, build it again in random order.
+
+		auto bytes = bench::allocated_bytes();
+		timer.restart();
+		Set grown;
+		for (auto key : shuffled)
+		{
+			grown.insert(key);
+		}
+		bench::report(label + " insert", n, n, timer.seconds());
+		std::cout << "    " << static_cast<double>(bench::allocated_bytes() - bytes) / n << " bytes per key\n";
+
+		timer.restart();
+		found = 0;
+		for (std::size_t index = 0; index < queries; index++)
+		{
+			found += grown.contains(shuffled[index] | (static_cast<int>(index) & 1));
+		}
+		bench::report(label + " contains after inserts", n, queries, timer.seconds());
+		bench::consume(found);
+	}
+}
+
+BENCHMARK(compact_tree)
+{
+	for (auto n : bench::sizes(5, 8))
+	{
+		// the even numbers below 2n, so there are gaps to miss.
+		std::vector<int> sorted(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			sorted[index] = static_cast<int>(2 * index);
+		}
+		auto shuffled = sorted;
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ 42 });
+
+		run<nwacc::tree<int, nwacc::avl>>("tree<avl>", sorted, shuffled, [&]() {
+			return nwacc::tree<int, nwacc::avl>::from_sorted(sorted.begin(), sorted.end());
+		});
+		run<nwacc::compact_tree<int>>("compact_tree", sorted, shuffled, [&]() {
+			return nwacc::compact_tree<int>::from_sorted(sorted.begin(), sorted.end());
+		});
+	}
+}
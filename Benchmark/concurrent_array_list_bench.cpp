@@ -0,0 +1,107 @@
+// Append throughput of nwacc::concurrent_array_list against a
+// nwacc::array_list behind one mutex, with every thread appending its
+// share of 10^6 to 10^7 ints, across the thread counts. The concurrent
+// list is run as it is and after reserving room for every value. Then
+// checks that each value landed exactly once.
+
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "array_list.h"
+#include "bench.h"
+#include "concurrent_array_list.h"
+
+namespace
+{
+	/**
+	 * The mutex wrapped list the concurrent list replaces.
+	 */
+	class locked_list
+	{
+	public:
+		void push_back(int value)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			this->list.push_back(value);
+		}
+
+		void reserve(std::size_t capacity)
+		{
+			this->list.reserve(static_cast<int>(capacity));
+		}
+
+		std::size_t size() const
+		{
+			return static_cast<std::size_t>(this->list.size());
+		}
+
+		int operator[](std::size_t index) const
+		{
+			return this->list[static_cast<int>(index)];
+		}
+
+	private:
+		std::mutex mutex;
+		nwacc::array_list<int> list;
+	};
+
+	template <typename List>
+	void run(const std::string &name, std::size_t n, int threads, bool reserve)
+	{
+		List list;
+		if (reserve)
+		{
+			list.reserve(n);
+		} // else, let it grow, do_nothing();
+
+		const auto share = n / threads;
+		std::vector<std::thread> workers;
+		bench::stopwatch timer;
+		for (auto thread = 0; thread < threads; thread++)
+		{
+			workers.emplace_back([&, thread]() {
+				auto first = static_cast<int>(thread * share);
+				for (std::size_t item = 0; item < share; item++)
+				{
+					list.push_back(first + static_cast<int>(item));
+				}
+			});
+		}
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+		auto seconds = timer.seconds();
+		bench::report(name + " threads=" + std::to_string(threads), n, share * threads, seconds);
+
+		std::vector<char> seen(share * threads, 0);
+		auto wrong = list.size() != seen.size();
+		for (std::size_t index = 0; index < list.size() && !wrong; index++)
+		{
+			auto value = static_cast<std::size_t>(list[index]);
+			wrong = value >= seen.size() || seen[value] != 0;
+			seen[value] = 1;
+		}
+		if (wrong)
+		{
+			std::cout << "    WRONG: values were lost or appended twice\n";
+		} // else, every value landed once, do_nothing();
+	}
+}
+
+BENCHMARK(concurrent_array_list)
+{
+	for (auto n : bench::sizes(6, 7))
+	{
+		for (auto threads : bench::thread_counts())
+		{
+			run<nwacc::concurrent_array_list<int>>("concurrent_array_list", n, threads, false);
+			run<nwacc::concurrent_array_list<int>>("concurrent_array_list, reserved", n, threads, true);
+			run<locked_list>("mutex + array_list", n, threads, false);
+		}
+	}
+}
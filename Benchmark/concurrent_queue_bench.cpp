@@ -0,0 +1,148 @@
+// Throughput of nwacc::concurrent_queue and nwacc::concurrent_stack against
+// a nwacc::linked_list behind one mutex, used as a work queue: producers
+// push a fixed number of ints each while consumers pop until every one
+// has been taken. Runs the same number of producers and consumers, then
+// one producer feeding many consumers, across the thread counts. Also
+// checks that each value came out exactly once.
+
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "concurrent_queue.h"
+#include "linked_list.h"
+
+namespace
+{
+	const std::size_t kItemsPerProducer = 200000;
+
+	/**
+	 * The mutex wrapped list the concurrent queue replaces.
+	 */
+	class locked_queue
+	{
+	public:
+		void push_back(int value)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			this->list.push_back(value);
+		}
+
+		bool pop_front(int &value)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			if (this->list.is_empty())
+			{
+				return false;
+			} // else, there is a value to take.
+
+			value = this->list.front();
+			this->list.pop_front();
+			return true;
+		}
+
+	private:
+		std::mutex mutex;
+		nwacc::linked_list<int> list;
+	};
+
+	// a stack has push_front where the queues have push_back.
+	struct stack_adapter
+	{
+		nwacc::concurrent_stack<int> stack;
+
+		void push_back(int value)
+		{
+			this->stack.push_front(value);
+		}
+
+		bool pop_front(int &value)
+		{
+			return this->stack.pop_front(value);
+		}
+	};
+
+	/**
+	 * Run producers and consumers on a fresh queue and report the pushes
+	 * and pops per second together.
+	 */
+	template <typename Queue>
+	void run(const std::string &name, int producers, int consumers)
+	{
+		Queue queue;
+		const auto total = producers * kItemsPerProducer;
+		std::atomic<std::size_t> taken{ 0 };
+		std::atomic<std::size_t> sum{ 0 };
+		std::vector<std::thread> workers;
+		bench::stopwatch timer;
+		for (auto producer = 0; producer < producers; producer++)
+		{
+			workers.emplace_back([&]() {
+				for (std::size_t item = 0; item < kItemsPerProducer; item++)
+				{
+					queue.push_back(static_cast<int>(item));
+				}
+			});
+		}
+		for (auto consumer = 0; consumer < consumers; consumer++)
+		{
+			workers.emplace_back([&]() {
+				std::size_t local = 0;
+				int value;
+				while (taken.load(std::memory_order_relaxed) < total)
+				{
+					if (queue.pop_front(value))
+					{
+						local += static_cast<std::size_t>(value);
+						taken.fetch_add(1, std::memory_order_relaxed);
+					}
+					else
+					{
+						std::this_thread::yield();
+					}
+				}
+				sum += local;
+			});
+		}
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+		auto seconds = timer.seconds();
+
+		bench::report(name + " producers=" + std::to_string(producers) + " consumers=" + std::to_string(consumers),
+			total, 2 * total, seconds);
+		if (sum != producers * (kItemsPerProducer * (kItemsPerProducer - 1) / 2))
+		{
+			std::cout << "    WRONG: values were lost or taken twice\n";
+		} // else, every value came out once, do_nothing();
+	}
+
+	template <typename Queue>
+	void scale(const std::string &name)
+	{
+		for (auto threads : bench::thread_counts())
+		{
+			run<Queue>(name, threads, threads);
+		}
+		for (auto threads : bench::thread_counts())
+		{
+			if (threads > 1)
+			{
+				run<Queue>(name, 1, threads);
+			} // else, already run above, do_nothing();
+		}
+	}
+}
+
+BENCHMARK(concurrent_queue)
+{
+	scale<nwacc::concurrent_queue<int>>("concurrent_queue");
+	scale<stack_adapter>("concurrent_stack");
+	scale<locked_queue>("mutex + linked_list");
+}
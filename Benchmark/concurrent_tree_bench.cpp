@@ -0,0 +1,218 @@
+// Scaling benchmark and stress run for nwacc::concurrent_tree against a
+// nwacc::tree behind one global mutex.
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench.h"
+#include "concurrent_tree.h"
+#include "tree.h"
+
+namespace
+{
+	const std::size_t kOperationsPerThread = 200000;
+
+	/**
+	 * The mutex wrapped tree the concurrent tree replaces.
+	 */
+	class locked_tree
+	{
+	public:
+		bool insert(int value)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			this->bst.insert(value);
+			return true;
+		}
+
+		bool remove(int value)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			this->bst.remove(value);
+			return true;
+		}
+
+		bool contains(int value) const
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			return this->bst.contains(value);
+		}
+
+	private:
+		mutable std::mutex mutex;
+		nwacc::tree<int, nwacc::avl> bst;
+	};
+
+	/**
+	 * Run threads threads, each doing kOperationsPerThread operations of
+	 * which write_percent are an insert or remove of an odd key and the
+	 * rest are lookups. Even keys are never touched by writers.
+	 */
+	template <typename Set>
+	void run_mix(const std::string &name, Set &set, std::size_t n, int threads, int write_percent)
+	{
+		std::vector<std::thread> workers;
+		std::atomic<std::size_t> found{ 0 };
+		bench::stopwatch timer;
+		for (auto thread = 0; thread < threads; thread++)
+		{
+			workers.emplace_back([&, thread]() {
+				std::mt19937 generator{ static_cast<unsigned>(thread + 1) };
+				std::uniform_int_distribution<int> keys(0, static_cast<int>(2 * n));
+				std::uniform_int_distribution<int> percent(0, 99);
+				std::size_t local = 0;
+				for (std::size_t operation = 0; operation < kOperationsPerThread; operation++)
+				{
+					auto key = keys(generator);
+					if (percent(generator) < write_percent)
+					{
+						key |= 1;
+						if (operation & 1)
+						{
+							set.insert(key);
+						}
+						else
+						{
+							set.remove(key);
+						}
+					}
+					else
+					{
+						local += set.contains(key);
+					}
+				}
+				found += local;
+			});
+		}
+		for (auto &worker : workers)
+		{
+			worker.join();
+		}
+		bench::report(name + " threads=" + std::to_string(threads), n, threads * kOperationsPerThread, timer.seconds());
+		bench::consume(found);
+	}
+
+	template <typename Set>
+	void fill_even(Set &set, std::size_t n)
+	{
+		for (std::size_t key = 0; key < n; key++)
+		{
+			set.insert(static_cast<int>(2 * key));
+		}
+	}
+}
+
+BENCHMARK(concurrent_tree_scaling)
+{
+	for (auto n : bench::sizes(6, 6))
+	{
+		nwacc::concurrent_tree<int> concurrent;
+		locked_tree locked;
+		fill_even(concurrent, n);
+		fill_even(locked, n);
+		// all writes shows how writers to different keys get on.
+		for (auto write_percent : { 0, 10, 100 })
+		{
+			auto mix = std::to_string(write_percent) + "% writes";
+			for (auto threads : bench::thread_counts())
+			{
+				run_mix("concurrent_tree " + mix, concurrent, n, threads, write_percent);
+				run_mix("mutex + tree<avl> " + mix, locked, n, threads, write_percent);
+			}
+		}
+	}
+}
+
+/**
+ * Writers hammer the odd keys while readers check that every even key,
+ * which nobody removes, is always found. Afterwards each writer's own key
+ * range must hold exactly what that writer last did to it.
+ */
+BENCHMARK(concurrent_tree_stress)
+{
+	const int kKeysPerWriter = 2000;
+	const std::size_t kRounds = 50000;
+	auto threads = std::max(4, bench::thread_counts().back());
+	auto writers = threads / 2;
+
+	nwacc::concurrent_tree<int> set;
+	for (auto key = 0; key < writers * kKeysPerWriter; key++)
+	{
+		set.insert(2 * key);
+	}
+
+	std::atomic<bool> done{ false };
+	std::atomic<std::size_t> misses{ 0 };
+	std::vector<std::vector<char>> present(writers, std::vector<char>(kKeysPerWriter, 0));
+	std::vector<std::thread> workers;
+	bench::stopwatch timer;
+	for (auto writer = 0; writer < writers; writer++)
+	{
+		workers.emplace_back([&, writer]() {
+			std::mt19937 generator{ static_cast<unsigned>(writer) };
+			for (std::size_t round = 0; round < kRounds; round++)
+			{
+				auto slot = static_cast<int>(generator() % kKeysPerWriter);
+				auto key = 2 * (writer * kKeysPerWriter + slot) + 1;
+				if (generator() & 1)
+				{
+					set.insert(key);
+					present[writer][slot] = 1;
+				}
+				else
+				{
+					set.remove(key);
+					present[writer][slot] = 0;
+				}
+			}
+		});
+	}
+	for (auto reader = writers; reader < threads; reader++)
+	{
+		workers.emplace_back([&, reader]() {
+			std::mt19937 generator{ static_cast<unsigned>(reader) };
+			while (!done.load())
+			{
+				auto key = 2 * static_cast<int>(generator() % (writers * kKeysPerWriter));
+				if (!set.contains(key))
+				{
+					misses++;
+				} // else, found as expected, do_nothing();
+			}
+		});
+	}
+	for (auto writer = 0; writer < writers; writer++)
+	{
+		workers[writer].join();
+	}
+	done = true;
+	for (auto reader = writers; reader < threads; reader++)
+	{
+		workers[reader].join();
+	}
+
+	std::size_t wrong = 0;
+	std::size_t expected_size = writers * kKeysPerWriter;
+	for (auto writer = 0; writer < writers; writer++)
+	{
+		for (auto slot = 0; slot < kKeysPerWriter; slot++)
+		{
+			auto key = 2 * (writer * kKeysPerWriter + slot) + 1;
+			wrong += set.contains(key) != (present[writer][slot] != 0);
+			expected_size += present[writer][slot];
+		}
+	}
+	wrong += set.size() != expected_size;
+	bench::report("concurrent_tree stress writes", expected_size, writers * kRounds, timer.seconds());
+	if (misses != 0 || wrong != 0)
+	{
+		std::cerr << "concurrent_tree stress FAILED: " << misses << " missed reads, " << wrong << " wrong keys\n";
+		std::exit(1);
+	} // else, every check passed, do_nothing();
+}
@@ -0,0 +1,301 @@
+// The container suite: insert, contains, remove, iterate, clone and
+// destroy for tree, array_list and linked_list, each against its standard
+// library counterpart (std::set, std::vector and std::list), for every key
+// distribution at 10^3 to 10^8 keys. Each line reports the time per
+// operation, the allocations per operation and the peak resident set size
+// so far. Sizes past --max are skipped; run with --max=100000000 for the
+// full range, which needs several gigabytes.
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "array_list.h"
+#include "bench.h"
+#include "linked_list.h"
+#include "tree.h"
+
+namespace
+{
+	// contains on a sequence is a linear scan; stop at this much work.
+	const std::size_t kLinearScanBudget = 100000000;
+	const std::size_t kLinearQueries = 1000;
+
+	/**
+	 * Run the operation once, then report how long it took and how many
+	 * allocations it made.
+	 */
+	template <typename Operation>
+	void measure(const std::string &name, std::size_t n, std::size_t operations, Operation operation)
+	{
+		auto allocations = bench::allocations();
+		bench::stopwatch timer;
+		operation();
+		auto seconds = timer.seconds();
+		bench::report(name, n, operations == 0 ? 1 : operations, seconds, bench::allocations() - allocations);
+	}
+
+	struct tree_operations
+	{
+		using container = nwacc::tree<int, nwacc::avl>;
+
+		static void insert(container &values, int key)
+		{
+			values.insert(key);
+		}
+
+		static bool contains(const container &values, int key)
+		{
+			return values.contains(key);
+		}
+
+		static void remove(container &values, int key)
+		{
+			values.remove(key);
+		}
+	};
+
+	struct set_operations
+	{
+		using container = std::set<int>;
+
+		static void insert(container &values, int key)
+		{
+			values.insert(key);
+		}
+
+		static bool contains(const container &values, int key)
+		{
+			return values.count(key) != 0;
+		}
+
+		static void remove(container &values, int key)
+		{
+			values.erase(key);
+		}
+	};
+
+	struct array_list_operations
+	{
+		using container = nwacc::array_list<int>;
+
+		static void insert(container &values, int key)
+		{
+			values.push_back(key);
+		}
+
+		static void remove(container &values)
+		{
+			values.pop_back();
+		}
+	};
+
+	struct vector_operations
+	{
+		using container = std::vector<int>;
+
+		static void insert(container &values, int key)
+		{
+			values.push_back(key);
+		}
+
+		static void remove(container &values)
+		{
+			values.pop_back();
+		}
+	};
+
+	struct linked_list_operations
+	{
+		using container = nwacc::linked_list<int>;
+
+		static void insert(container &values, int key)
+		{
+			values.push_back(key);
+		}
+
+		static void remove(container &values)
+		{
+			values.pop_back();
+		}
+	};
+
+	struct list_operations
+	{
+		using container = std::list<int>;
+
+		static void insert(container &values, int key)
+		{
+			values.push_back(key);
+		}
+
+		static void remove(container &values)
+		{
+			values.pop_back();
+		}
+	};
+
+	// a hand written loop, as linked_list's iterators are not usable with
+	// the standard algorithms.
+	template <typename Container>
+	bool linear_contains(const Container &values, int key)
+	{
+		for (auto value : values)
+		{
+			if (value == key)
+			{
+				return true;
+			} // else, keep looking, do_nothing();
+		}
+		return false;
+	}
+
+	template <typename Container>
+	void iterate(const std::string &name, std::size_t n, const Container &values, std::size_t count)
+	{
+		measure(name + " iterate", n, count, [&] {
+			std::size_t sum = 0;
+			for (auto value : values)
+			{
+				sum += static_cast<std::size_t>(value);
+			}
+			bench::consume(sum);
+		});
+	}
+
+	template <typename Container>
+	void clone_and_destroy(const std::string &name, std::size_t n, std::unique_ptr<Container> &values, std::size_t count, std::unique_ptr<Container> &copy)
+	{
+		measure(name + " clone", n, count, [&] {
+			copy.reset(new Container(*values));
+		});
+		measure(name + " destroy", n, count, [&] {
+			values.reset();
+		});
+	}
+
+	/**
+	 * The suite for an ordered set. contains looks up every key in a
+	 * shuffled order; remove takes every key out of a clone in the order
+	 * they went in.
+	 */
+	template <typename Operations>
+	void run_ordered(const std::string &label, const std::vector<int> &keys, const std::vector<int> &queries)
+	{
+		using container = typename Operations::container;
+		const auto n = keys.size();
+		auto values = std::unique_ptr<container>(new container());
+		measure(label + " insert", n, n, [&] {
+			for (auto key : keys)
+			{
+				Operations::insert(*values, key);
+			}
+		});
+		measure(label + " contains", n, n, [&] {
+			std::size_t found = 0;
+			for (auto key : queries)
+			{
+				found += Operations::contains(*values, key);
+			}
+			bench::consume(found);
+		});
+
+		const auto count = values->size();
+		iterate(label, n, *values, count);
+		std::unique_ptr<container> copy;
+		clone_and_destroy(label, n, values, count, copy);
+		measure(label + " remove", n, n, [&] {
+			for (auto key : keys)
+			{
+				Operations::remove(*copy, key);
+			}
+		});
+	}
+
+	/**
+	 * The suite for a sequence. Values are appended; contains is a linear
+	 * search for a sample of the keys; remove pops every value off the
+	 * back of a clone.
+	 */
+	template <typename Operations>
+	void run_sequence(const std::string &label, const std::vector<int> &keys, const std::vector<int> &queries)
+	{
+		using container = typename Operations::container;
+		const auto n = keys.size();
+		auto values = std::unique_ptr<container>(new container());
+		measure(label + " insert", n, n, [&] {
+			for (auto key : keys)
+			{
+				Operations::insert(*values, key);
+			}
+		});
+
+		auto searches = std::min(kLinearQueries, std::max<std::size_t>(1, kLinearScanBudget / n));
+		measure(label + " contains", n, searches, [&] {
+			std::size_t found = 0;
+			for (std::size_t index = 0; index < searches; index++)
+			{
+				found += linear_contains(*values, queries[index]);
+			}
+			bench::consume(found);
+		});
+		iterate(label, n, *values, n);
+
+		std::unique_ptr<container> copy;
+		clone_and_destroy(label, n, values, n, copy);
+		measure(label + " remove", n, n, [&] {
+			for (std::size_t index = 0; index < n; index++)
+			{
+				Operations::remove(*copy);
+			}
+		});
+	}
+
+	/**
+	 * Run the suite over every distribution and size, building the keys
+	 * once for the container and its baseline.
+	 */
+	template <typename Suite>
+	void for_each_input(Suite suite)
+	{
+		for (auto keys_from : bench::distributions())
+		{
+			for (auto n : bench::sizes(3, 8))
+			{
+				auto keys = bench::make_keys(keys_from, n);
+				auto queries = keys;
+				std::shuffle(queries.begin(), queries.end(), std::mt19937{ 7 });
+				suite(bench::to_string(keys_from), keys, queries);
+			}
+		}
+	}
+}
+
+BENCHMARK(tree_suite)
+{
+	for_each_input([](const std::string &keys_from, const std::vector<int> &keys, const std::vector<int> &queries) {
+		run_ordered<tree_operations>("tree<avl> " + keys_from, keys, queries);
+		run_ordered<set_operations>("std::set " + keys_from, keys, queries);
+	});
+}
+
+BENCHMARK(array_list_suite)
+{
+	for_each_input([](const std::string &keys_from, const std::vector<int> &keys, const std::vector<int> &queries) {
+		run_sequence<array_list_operations>("array_list " + keys_from, keys, queries);
+		run_sequence<vector_operations>("std::vector " + keys_from, keys, queries);
+	});
+}
+
+BENCHMARK(linked_list_suite)
+{
+	for_each_input([](const std::string &keys_from, const std::vector<int> &keys, const std::vector<int> &queries) {
+		run_sequence<linked_list_operations>("linked_list " + keys_from, keys, queries);
+		run_sequence<list_operations>("std::list " + keys_from, keys, queries);
+	});
+}
@@ -0,0 +1,87 @@
+// Benchmarks for dumping a tree as text: writing each value followed by
+// std::endl (how print_in_order used to work), print_in_order as it is
+// now, and tree::write streaming through a buffered_writer to a file and
+// to memory. Reports the dump throughput in MB/s.
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "buffered_writer.h"
+#include "tree.h"
+
+namespace
+{
+	using avl_tree = nwacc::tree<int, nwacc::avl>;
+
+	const char *kDumpPath = "export_bench.txt";
+
+	/**
+	 * Time a dump to the file and report it along with its throughput,
+	 * measured from the size of the file written.
+	 */
+	template <typename Dump>
+	void time_dump(const std::string &name, std::size_t n, Dump dump)
+	{
+		bench::stopwatch timer;
+		{
+			std::ofstream out{ kDumpPath };
+			dump(out);
+		}
+		auto seconds = timer.seconds();
+		std::ifstream in{ kDumpPath, std::ios::binary | std::ios::ate };
+		auto bytes = static_cast<double>(in.tellg());
+		bench::report(name, n, n, seconds);
+		std::cout << "    " << bytes / seconds / 1e6 << " MB/s\n";
+	}
+}
+
+BENCHMARK(tree_export)
+{
+	for (auto n : bench::sizes(4, 7))
+	{
+		std::vector<int> keys(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			keys[index] = static_cast<int>(3 * index);
+		}
+		auto bst = avl_tree::from_sorted(keys.begin(), keys.end());
+
+		if (n <= 1000000)
+		{
+			time_dump("value << std::endl", n, [&](std::ostream &out) {
+				for (auto value : bst)
+				{
+					out << value << std::endl;
+				}
+			});
+		}
+		else
+		{
+			bench::skip("value << std::endl", n, "a flush per value");
+		}
+
+		time_dump("print_in_order", n, [&](std::ostream &out) {
+			bst.print_in_order(out);
+		});
+		time_dump("tree::write, ostream_sink", n, [&](std::ostream &out) {
+			bst.write(nwacc::ostream_sink(out));
+		});
+
+		std::string text;
+		text.reserve(12 * n);
+		bench::stopwatch timer;
+		bst.write(nwacc::make_iterator_sink(std::back_inserter(text)));
+		auto seconds = timer.seconds();
+		bench::report("tree::write, iterator_sink to memory", n, n, seconds);
+		std::cout << "    " << text.size() / seconds / 1e6 << " MB/s\n";
+		bench::consume(text.size());
+
+		std::remove(kDumpPath);
+	}
+}
@@ -0,0 +1,79 @@
+// Benchmarks for lookups in a frozen nwacc::flat_tree snapshot against the
+// pointer based nwacc::tree it was built from.
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "flat_tree.h"
+#include "tree.h"
+
+namespace
+{
+	const std::size_t kLookups = 1000000;
+
+	// Even keys are stored, so half of the random probes miss.
+	std::vector<int> probes(std::size_t n)
+	{
+		std::mt19937 generator{ 7 };
+		std::uniform_int_distribution<int> distribution(0, static_cast<int>(2 * n));
+		std::vector<int> result(kLookups);
+		for (auto &probe : result)
+		{
+			probe = distribution(generator);
+		}
+		return result;
+	}
+
+	template <typename Set>
+	void time_contains(const std::string &name, const Set &set, const std::vector<int> &keys, std::size_t n)
+	{
+		std::size_t found = 0;
+		bench::stopwatch timer;
+		for (auto key : keys)
+		{
+			found += set.contains(key);
+		}
+		bench::report(name, n, keys.size(), timer.seconds());
+		bench::consume(found);
+	}
+}
+
+BENCHMARK(flat_tree_lookup)
+{
+	for (auto n : bench::sizes(5, 8))
+	{
+		nwacc::tree<int, nwacc::avl> bst;
+		std::vector<int> shuffled(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			shuffled[index] = static_cast<int>(2 * index);
+		}
+		std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937{ 42 });
+		for (auto key : shuffled)
+		{
+			bst.insert(key);
+		}
+
+		bench::stopwatch timer;
+		auto snapshot = bst.freeze();
+		bench::report("tree<avl>::freeze", n, n, timer.seconds());
+
+		auto keys = probes(n);
+		time_contains("tree<avl>::contains", bst, keys, n);
+		time_contains("flat_tree::contains", snapshot, keys, n);
+
+		std::sort(shuffled.begin(), shuffled.end());
+		std::size_t found = 0;
+		timer.restart();
+		for (auto key : keys)
+		{
+			found += std::binary_search(shuffled.begin(), shuffled.end(), key);
+		}
+		bench::report("std::binary_search (baseline)", n, keys.size(), timer.seconds());
+		bench::consume(found);
+	}
+}
@@ -0,0 +1,92 @@
+// Benchmarks for sorting a linked_list of random ints: linked_list::sort,
+// which relinks the nodes, on one thread and across the thread counts;
+// copying the values into an array_list, sorting that and copying them
+// back; and std::list::sort. Also times merging two sorted halves with
+// linked_list::merge. Each line also reports the allocations made per
+// element; array_list takes its memory from malloc, so its copy does not
+// show up in the counts.
+
+#include <algorithm>
+#include <cstddef>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "array_list.h"
+#include "bench.h"
+#include "linked_list.h"
+
+namespace
+{
+	template <typename List>
+	void fill(List &list, const std::vector<int> &keys)
+	{
+		for (auto key : keys)
+		{
+			list.push_back(key);
+		}
+	}
+
+	// time the operation on a fresh list holding the keys.
+	template <typename List, typename Operation>
+	void measure(const std::string &name, const std::vector<int> &keys, Operation operation)
+	{
+		List list;
+		fill(list, keys);
+		auto allocations = bench::allocations();
+		bench::stopwatch timer;
+		operation(list);
+		auto seconds = timer.seconds();
+		bench::report(name, keys.size(), keys.size(), seconds, bench::allocations() - allocations);
+		bench::consume(static_cast<std::size_t>(list.front()));
+	}
+}
+
+BENCHMARK(linked_list_sort)
+{
+	for (auto n : bench::sizes(5, 7))
+	{
+		auto keys = bench::make_keys(bench::distribution::uniform, n);
+
+		for (auto threads : bench::thread_counts())
+		{
+			measure<nwacc::linked_list<int>>("linked_list::sort, " + std::to_string(threads) + " threads", keys, [&](nwacc::linked_list<int> &list) {
+				list.sort(std::less<int>{}, static_cast<unsigned>(threads));
+			});
+		}
+
+		measure<nwacc::linked_list<int>>("copy to array_list, std::sort, copy back", keys, [](nwacc::linked_list<int> &list) {
+			nwacc::array_list<int> values(list.size());
+			for (auto value : list)
+			{
+				values.push_back(value);
+			}
+			std::sort(values.begin(), values.end());
+			auto next = values.begin();
+			for (auto &value : list)
+			{
+				value = *next++;
+			}
+		});
+
+		measure<std::list<int>>("std::list::sort", keys, [](std::list<int> &list) {
+			list.sort();
+		});
+
+		// two sorted halves, merged by relinking.
+		std::vector<int> lower(keys.begin(), keys.begin() + n / 2);
+		std::vector<int> upper(keys.begin() + n / 2, keys.end());
+		std::sort(lower.begin(), lower.end());
+		std::sort(upper.begin(), upper.end());
+		nwacc::linked_list<int> first;
+		nwacc::linked_list<int> second;
+		fill(first, lower);
+		fill(second, upper);
+		auto allocations = bench::allocations();
+		bench::stopwatch timer;
+		first.merge(second);
+		auto seconds = timer.seconds();
+		bench::report("linked_list::merge", n, n, seconds, bench::allocations() - allocations);
+		bench::consume(static_cast<std::size_t>(first.size()));
+	}
+}
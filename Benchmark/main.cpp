@@ -0,0 +1,346 @@
+// Runs the registered benchmarks.
+// Usage: benchmark [filter] [--max=N] [--threads=N]
+// Only benchmarks whose name contains the filter are run, no input is
+// larger than N elements (1000000 by default), and multi-threaded runs
+// use at most N threads (the hardware concurrency by default).
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+#include "bench.h"
+
+namespace bench
+{
+	namespace
+	{
+		std::vector<std::pair<std::string, benchmark_function>> &registry()
+		{
+			static std::vector<std::pair<std::string, benchmark_function>> benchmarks;
+			return benchmarks;
+		}
+
+		std::size_t max_size = 1000000;
+		int max_threads = static_cast<int>(std::thread::hardware_concurrency());
+		volatile std::size_t sink;
+		std::atomic<std::size_t> allocation_count{ 0 };
+		std::atomic<std::size_t> live_bytes{ 0 };
+
+		// every block starts with a header holding its size, padded so the
+		// memory handed out keeps the alignment malloc gave it.
+		const std::size_t kHeaderSize = alignof(std::max_align_t);
+
+		// mix the bits of a rank so neighbouring ranks land far apart.
+		std::uint32_t scramble(std::uint32_t value)
+		{
+			value ^= value >> 16;
+			value *= 0x85ebca6bU;
+			value ^= value >> 13;
+			value *= 0xc2b2ae35U;
+			value ^= value >> 16;
+			return value;
+		}
+
+		/**
+		 * Draw ranks from 0 to n - 1 with probability proportional to
+		 * 1 / (rank + 1)^theta, using the method of Gray et al., "Quickly
+		 * Generating Billion-Record Synthetic Databases".
+		 */
+		std::vector<std::uint32_t> zipf_ranks(std::size_t n, double theta, std::mt19937 &engine)
+		{
+			double zeta_n = 0.0;
+			for (std::size_t rank = 1; rank <= n; rank++)
+			{
+				zeta_n += 1.0 / std::pow(static_cast<double>(rank), theta);
+			}
+			const double zeta_2 = 1.0 + 1.0 / std::pow(2.0, theta);
+			const double alpha = 1.0 / (1.0 - theta);
+			const double eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta_2 / zeta_n);
+
+			std::uniform_real_distribution<double> unit{ 0.0, 1.0 };
+			std::vector<std::uint32_t> ranks(n);
+			for (auto &rank : ranks)
+			{
+				auto u = unit(engine);
+				auto uz = u * zeta_n;
+				if (uz < 1.0)
+				{
+					rank = 0;
+				}
+				else if (uz < zeta_2)
+				{
+					rank = 1;
+				}
+				else
+				{
+					auto drawn = static_cast<std::size_t>(n * std::pow(eta * u - eta + 1.0, alpha));
+					rank = static_cast<std::uint32_t>(drawn < n ? drawn : n - 1);
+				}
+			}
+			return ranks;
+		}
+	}
+
+	registration::registration(const char *name, benchmark_function function)
+	{
+		registry().emplace_back(name, function);
+	}
+
+	std::vector<std::size_t> sizes(int low, int high)
+	{
+		std::vector<std::size_t> result;
+		std::size_t n = 1;
+		for (auto exponent = 0; exponent <= high; exponent++)
+		{
+			if (exponent >= low && n <= max_size)
+			{
+				result.push_back(n);
+			} // else, outside the requested range, do_nothing();
+			n *= 10;
+		}
+		return result;
+	}
+
+	std::vector<int> thread_counts()
+	{
+		std::vector<int> result;
+		auto limit = max_threads > 0 ? max_threads : 1;
+		for (auto threads = 1; threads < limit; threads *= 2)
+		{
+			result.push_back(threads);
+		}
+		result.push_back(limit);
+		return result;
+	}
+
+	void report(const std::string &name, std::size_t n, std::size_t operations, double seconds)
+	{
+		std::cout << std::left << std::setw(44) << name
+			<< " n=" << std::setw(10) << n
+			<< std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << (seconds * 1e9 / operations) << " ns/op"
+			<< std::setw(12) << (operations / seconds / 1e6) << " Mops/s\n";
+	}
+
+	void report(const std::string &name, std::size_t n, std::size_t operations, double seconds, std::size_t allocations)
+	{
+		std::cout << std::left << std::setw(44) << name
+			<< " n=" << std::setw(10) << n
+			<< std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << (seconds * 1e9 / operations) << " ns/op"
+			<< std::setw(12) << (operations / seconds / 1e6) << " Mops/s"
+			<< std::setw(10) << (static_cast<double>(allocations) / operations) << " allocs/op"
+			<< std::setw(10) << (peak_rss() / 1e6) << " MB peak\n";
+	}
+
+	void skip(const std::string &name, std::size_t n, const std::string &reason)
+	{
+		std::cout << std::left << std::setw(44) << name
+			<< " n=" << std::setw(10) << n << " skipped: " << reason << '\n';
+	}
+
+	void consume(std::size_t value)
+	{
+		sink = sink + value;
+	}
+
+	std::size_t allocations()
+	{
+		return allocation_count.load(std::memory_order_relaxed);
+	}
+
+	std::size_t allocated_bytes()
+	{
+		return live_bytes.load(std::memory_order_relaxed);
+	}
+
+	std::size_t peak_rss()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters;
+		if (::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return counters.PeakWorkingSetSize;
+		} // else, no counters, fall through.
+		return 0;
+#else
+		struct rusage usage;
+		if (::getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		} // else, we have the high water mark.
+#if defined(__APPLE__)
+		return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+		// Linux and the BSDs report kilobytes.
+		return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+
+	std::vector<distribution> distributions()
+	{
+		return { distribution::uniform, distribution::sorted, distribution::reverse,
+			distribution::zipfian, distribution::clustered };
+	}
+
+	std::string to_string(distribution keys)
+	{
+		switch (keys)
+		{
+		case distribution::uniform:
+			return "uniform";
+		case distribution::sorted:
+			return "sorted";
+		case distribution::reverse:
+			return "reverse";
+		case distribution::zipfian:
+			return "zipfian";
+		case distribution::clustered:
+			return "clustered";
+		}
+		return "unknown";
+	}
+
+	std::vector<int> make_keys(distribution keys, std::size_t n, unsigned seed)
+	{
+		std::mt19937 engine{ seed };
+		std::vector<int> result(n);
+		switch (keys)
+		{
+		case distribution::uniform:
+		{
+			std::uniform_int_distribution<int> any{ 0, 0x7fffffff };
+			std::generate(result.begin(), result.end(), [&] { return any(engine); });
+			break;
+		}
+		case distribution::sorted:
+			for (std::size_t index = 0; index < n; index++)
+			{
+				result[index] = static_cast<int>(index);
+			}
+			break;
+		case distribution::reverse:
+			for (std::size_t index = 0; index < n; index++)
+			{
+				result[index] = static_cast<int>(n - 1 - index);
+			}
+			break;
+		case distribution::zipfian:
+		{
+			auto ranks = zipf_ranks(n, 0.99, engine);
+			for (std::size_t index = 0; index < n; index++)
+			{
+				result[index] = static_cast<int>(scramble(ranks[index]) & 0x7fffffff);
+			}
+			break;
+		}
+		case distribution::clustered:
+		{
+			// runs of 1024 keys, each within 4096 of a random center.
+			const int kSpread = 4096;
+			std::vector<int> centers(n / 1024 + 1);
+			std::uniform_int_distribution<int> any{ 0, 0x7fffffff - kSpread };
+			std::generate(centers.begin(), centers.end(), [&] { return any(engine); });
+			std::uniform_int_distribution<int> offset{ 0, kSpread - 1 };
+			for (std::size_t index = 0; index < n; index++)
+			{
+				result[index] = centers[index / 1024] + offset(engine);
+			}
+			break;
+		}
+		}
+		return result;
+	}
+}
+
+// Count every heap allocation the program makes, and the bytes still held,
+// so benchmarks can report allocations per operation and memory use. The
+// array and nothrow forms forward here.
+void *operator new(std::size_t size)
+{
+	auto *block = static_cast<char *>(std::malloc(bench::kHeaderSize + size));
+	if (block == nullptr)
+	{
+		throw std::bad_alloc{};
+	} // else, record it.
+
+	*reinterpret_cast<std::size_t *>(block) = size;
+	bench::allocation_count.fetch_add(1, std::memory_order_relaxed);
+	bench::live_bytes.fetch_add(size, std::memory_order_relaxed);
+	return block + bench::kHeaderSize;
+}
+
+void operator delete(void *pointer) noexcept
+{
+	if (pointer == nullptr)
+	{
+		return;
+	} // else, find the header in front of it.
+
+	auto *block = static_cast<char *>(pointer) - bench::kHeaderSize;
+	bench::live_bytes.fetch_sub(*reinterpret_cast<std::size_t *>(block), std::memory_order_relaxed);
+	std::free(block);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept
+{
+	::operator delete(pointer);
+}
+
+int main(int argc, char *argv[])
+{
+	std::string filter;
+	for (auto index = 1; index < argc; index++)
+	{
+		if (std::strncmp(argv[index], "--max=", 6) == 0)
+		{
+			bench::max_size = std::strtoull(argv[index] + 6, nullptr, 10);
+		}
+		else if (std::strncmp(argv[index], "--threads=", 10) == 0)
+		{
+			bench::max_threads = std::atoi(argv[index] + 10);
+		}
+		else
+		{
+			filter = argv[index];
+		}
+	}
+
+	for (auto &benchmark : bench::registry())
+	{
+		if (benchmark.first.find(filter) != std::string::npos)
+		{
+			std::cout << "== " << benchmark.first << " ==" << std::endl;
+			benchmark.second();
+		} // else, filtered out, do_nothing();
+	}
+
+	return 0;
+}
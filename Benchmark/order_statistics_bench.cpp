@@ -0,0 +1,81 @@
+// Benchmarks for the subtree size queries on nwacc::tree (rank, select,
+// count_range) against answering the same questions with an in-order walk.
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace
+{
+	const std::size_t kQueries = 1000;
+
+	// the linear walks are capped at about 10^8 steps per measurement.
+	std::size_t walk_queries(std::size_t n)
+	{
+		return std::max<std::size_t>(1, std::min(kQueries, 100000000 / n));
+	}
+}
+
+BENCHMARK(order_statistics)
+{
+	for (auto n : bench::sizes(3, 6))
+	{
+		std::vector<int> keys(n);
+		std::iota(keys.begin(), keys.end(), 0);
+		std::mt19937 generator{ 42 };
+		std::shuffle(keys.begin(), keys.end(), generator);
+		nwacc::tree<int, nwacc::avl> bst;
+		for (auto key : keys)
+		{
+			bst.insert(key);
+		}
+
+		std::uniform_int_distribution<int> distribution(0, static_cast<int>(n - 1));
+		std::vector<int> lows(kQueries);
+		for (auto &low : lows)
+		{
+			low = distribution(generator);
+		}
+		const auto width = static_cast<int>(n / 10 + 1);
+
+		std::size_t total = 0;
+		bench::stopwatch timer;
+		for (auto low : lows)
+		{
+			total += bst.count_range(low, low + width);
+		}
+		bench::report("tree::count_range", n, kQueries, timer.seconds());
+
+		const auto walks = walk_queries(n);
+		timer.restart();
+		for (std::size_t query = 0; query < walks; query++)
+		{
+			for (auto value : bst)
+			{
+				total += (value >= lows[query] && value < lows[query] + width);
+			}
+		}
+		bench::report("count_range by in-order walk", n, walks, timer.seconds());
+
+		timer.restart();
+		for (auto low : lows)
+		{
+			total += *bst.select(static_cast<std::size_t>(low));
+		}
+		bench::report("tree::select", n, kQueries, timer.seconds());
+
+		timer.restart();
+		for (std::size_t query = 0; query < walks; query++)
+		{
+			total += *std::next(bst.begin(), lows[query]);
+		}
+		bench::report("select by std::next(begin(), k)", n, walks, timer.seconds());
+		bench::consume(total);
+	}
+}
@@ -0,0 +1,93 @@
+// Benchmarks for sorting uniformly random ints in an array_list against
+// a std::vector: std::sort, std::sort with the parallel execution policy
+// (where the standard library has one; with libstdc++ that needs TBB, which
+// the CMake build links when it finds it), and a sort that splits the
+// range across std::async threads and merges the halves. Run with
+// --max=100000000 for the 10^8 case.
+
+#include <algorithm>
+#include <cstddef>
+#include <future>
+#include <string>
+#include <vector>
+
+#if defined(_MSVC_LANG) && _MSVC_LANG >= 201703L && !defined(NWACC_PARALLEL_STL)
+#define NWACC_PARALLEL_STL 1
+#endif
+
+#if defined(NWACC_PARALLEL_STL)
+#include <execution>
+#endif
+
+#include "array_list.h"
+#include "bench.h"
+
+namespace
+{
+	// below this, a range is sorted on the calling thread.
+	const std::ptrdiff_t kSerialCutoff = 1 << 16;
+
+	/**
+	 * Sort each half on its own thread, then merge them.
+	 */
+	template <typename RandomIterator>
+	void async_sort(RandomIterator first, RandomIterator last, int threads)
+	{
+		if (threads <= 1 || last - first < kSerialCutoff)
+		{
+			std::sort(first, last);
+			return;
+		} // else, split the work.
+
+		auto middle = first + (last - first) / 2;
+		auto left = std::async(std::launch::async, [=] {
+			async_sort(first, middle, threads / 2);
+		});
+		async_sort(middle, last, threads - threads / 2);
+		left.get();
+		std::inplace_merge(first, middle, last);
+	}
+
+	template <typename List, typename Sort>
+	void time_sort(const std::string &name, const std::vector<int> &keys, Sort sort)
+	{
+		List values;
+		values.insert(values.end(), keys.begin(), keys.end());
+		bench::stopwatch timer;
+		sort(values.begin(), values.end());
+		auto seconds = timer.seconds();
+		bench::report(name, keys.size(), keys.size(), seconds);
+		bench::consume(std::is_sorted(values.begin(), values.end()));
+	}
+
+	template <typename List>
+	void sorts(const std::string &label, const std::vector<int> &keys)
+	{
+		time_sort<List>(label + " std::sort", keys, [](auto first, auto last) {
+			std::sort(first, last);
+		});
+#if defined(NWACC_PARALLEL_STL)
+		time_sort<List>(label + " std::sort(par)", keys, [](auto first, auto last) {
+			std::sort(std::execution::par, first, last);
+		});
+#else
+		bench::skip(label + " std::sort(par)", keys.size(), "no parallel algorithms");
+#endif
+		for (auto threads : bench::thread_counts())
+		{
+			time_sort<List>(label + " async_sort, " + std::to_string(threads) + " threads", keys, [threads](auto first, auto last) {
+				async_sort(first, last, threads);
+			});
+		}
+	}
+}
+
+BENCHMARK(parallel_sort)
+{
+	for (auto n : bench::sizes(6, 8))
+	{
+		auto keys = bench::make_keys(bench::distribution::uniform, n);
+		sorts<nwacc::array_list<int>>("array_list", keys);
+		sorts<std::vector<int>>("std::vector", keys);
+	}
+}
@@ -0,0 +1,119 @@
+// Benchmarks for keeping snapshots of a tree: the cost of taking one with
+// the deep copying tree copy constructor against an O(1) persistent_tree
+// copy, the cost of inserting while snapshots are held, and the memory
+// that many versions of a persistent_tree take over a single one.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "persistent_tree.h"
+#include "tree.h"
+
+namespace
+{
+	using avl_tree = nwacc::tree<int, nwacc::avl>;
+	using snapshot_tree = nwacc::persistent_tree<int>;
+
+	std::vector<int> shuffled_keys(std::size_t n)
+	{
+		std::vector<int> keys(n);
+		std::iota(keys.begin(), keys.end(), 0);
+		std::shuffle(keys.begin(), keys.end(), std::mt19937{ 42 });
+		return keys;
+	}
+
+	// enough snapshots to time, without keeping a million full copies.
+	const std::size_t kSnapshots = 100;
+}
+
+BENCHMARK(persistent_snapshot)
+{
+	for (auto n : bench::sizes(3, 6))
+	{
+		auto keys = shuffled_keys(n);
+		avl_tree deep;
+		snapshot_tree persistent;
+		for (auto key : keys)
+		{
+			deep.insert(key);
+			persistent.insert(key);
+		}
+
+		bench::stopwatch timer;
+		for (std::size_t index = 0; index < kSnapshots; index++)
+		{
+			avl_tree copy{ deep };
+			bench::consume(copy.size());
+		}
+		bench::report("tree copy constructor", n, kSnapshots, timer.seconds());
+
+		timer.restart();
+		for (std::size_t index = 0; index < kSnapshots; index++)
+		{
+			snapshot_tree copy{ persistent };
+			bench::consume(copy.size());
+		}
+		bench::report("persistent_tree copy", n, kSnapshots, timer.seconds());
+	}
+}
+
+BENCHMARK(persistent_versions)
+{
+	for (auto n : bench::sizes(3, 6))
+	{
+		auto keys = shuffled_keys(2 * n);
+
+		// insert the first half, then time inserting the second half with
+		// and without holding a version after every insert.
+		auto first_half = [&]() {
+			snapshot_tree result;
+			for (std::size_t index = 0; index < n; index++)
+			{
+				result.insert(keys[index]);
+			}
+			return result;
+		};
+
+		// nothing else shares this tree's nodes, so updates happen in place.
+		auto unshared = first_half();
+		bench::stopwatch timer;
+		for (auto index = n; index < 2 * n; index++)
+		{
+			unshared.insert(keys[index]);
+		}
+		bench::report("insert, no versions held", n, n, timer.seconds());
+
+		std::vector<snapshot_tree> versions;
+		versions.reserve(n);
+		auto current = first_half();
+		auto before = bench::allocated_bytes();
+		timer.restart();
+		for (auto index = n; index < 2 * n; index++)
+		{
+			current.insert(keys[index]);
+			versions.push_back(current);
+		}
+		bench::report("insert, every version held", n, n, timer.seconds());
+		auto version_bytes = bench::allocated_bytes() - before;
+
+		// what one full copy of the final version would take.
+		before = bench::allocated_bytes();
+		{
+			snapshot_tree full;
+			for (auto key : keys)
+			{
+				full.insert(key);
+			}
+			std::cout << "    " << n << " versions: " << static_cast<double>(version_bytes) / n
+				<< " bytes/version, against " << static_cast<double>(bench::allocated_bytes() - before)
+				<< " bytes for one full copy\n";
+		}
+		bench::consume(versions.back().size() + unshared.size());
+	}
+}
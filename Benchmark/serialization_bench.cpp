@@ -0,0 +1,99 @@
+// Benchmarks for persisting a tree across a restart: dumping it as text
+// with print_in_order and inserting the parsed values back one at a time,
+// against tree::save and tree::load, and against mapping the saved file
+// with mapped_tree and querying it in place. Reports the time to save,
+// the time until the first lookup can be answered, and the file size.
+
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "mapped_tree.h"
+#include "tree.h"
+
+namespace
+{
+	using avl_tree = nwacc::tree<int, nwacc::avl>;
+
+	const char *kTextPath = "serialization_bench.txt";
+	const char *kBinaryPath = "serialization_bench.bin";
+
+	std::size_t file_size(const char *path)
+	{
+		std::ifstream in{ path, std::ios::binary | std::ios::ate };
+		return static_cast<std::size_t>(in.tellg());
+	}
+
+	void report_size(const std::string &name, std::size_t n, const char *path)
+	{
+		auto bytes = file_size(path);
+		std::cout << "    " << name << ": " << bytes / 1e6 << " MB, "
+			<< static_cast<double>(bytes) / n << " bytes/key\n";
+	}
+}
+
+BENCHMARK(serialization)
+{
+	for (auto n : bench::sizes(5, 7))
+	{
+		// every third int, so the text has numbers of every length.
+		std::vector<int> keys(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			keys[index] = static_cast<int>(3 * index);
+		}
+		auto bst = avl_tree::from_sorted(keys.begin(), keys.end());
+
+		bench::stopwatch timer;
+		{
+			std::ofstream out{ kTextPath };
+			bst.print_in_order(out);
+		}
+		bench::report("save, print_in_order text", n, n, timer.seconds());
+		report_size("text", n, kTextPath);
+
+		timer.restart();
+		{
+			std::ifstream in{ kTextPath };
+			avl_tree restored;
+			int value;
+			while (in >> value)
+			{
+				restored.insert(value);
+			}
+			bench::consume(restored.size());
+		}
+		bench::report("restart, parse and insert", n, n, timer.seconds());
+
+		for (auto layout : { nwacc::tree_file::layout::sorted, nwacc::tree_file::layout::eytzinger })
+		{
+			auto suffix = std::string(layout == nwacc::tree_file::layout::sorted ? ", sorted" : ", eytzinger");
+			timer.restart();
+			bst.save(kBinaryPath, layout);
+			bench::report("save, binary" + suffix, n, n, timer.seconds());
+			report_size("binary" + suffix, n, kBinaryPath);
+
+			timer.restart();
+			{
+				auto restored = avl_tree::load(kBinaryPath);
+				bench::consume(restored.contains(keys[n / 2]));
+			}
+			bench::report("restart, tree::load" + suffix, n, n, timer.seconds());
+
+			timer.restart();
+			{
+				nwacc::mapped_tree<int> mapped{ kBinaryPath };
+				bench::consume(mapped.contains(keys[n / 2]));
+			}
+			bench::report("restart, mapped_tree" + suffix, n, n, timer.seconds());
+		}
+
+		std::remove(kTextPath);
+		std::remove(kBinaryPath);
+	}
+}
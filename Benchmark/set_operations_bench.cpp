@@ -0,0 +1,74 @@
+// Benchmarks for merging two large trees: inserting the values of one
+// into the other one at a time, against the join based union_with,
+// intersect and difference on 1 to --threads threads. Each pair of trees
+// shares half of its keys.
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace
+{
+	using avl_tree = nwacc::tree<int, nwacc::avl>;
+
+	template <typename Operation>
+	void time_operation(const std::string &name, std::size_t n, const avl_tree &first, const avl_tree &second, Operation operation)
+	{
+		// the operations consume their input, so each run works on copies
+		// made outside the timed region.
+		avl_tree target{ first };
+		avl_tree source{ second };
+		bench::stopwatch timer;
+		operation(target, source);
+		bench::report(name, n, 2 * n, timer.seconds());
+		bench::consume(target.size());
+	}
+}
+
+BENCHMARK(set_operations)
+{
+	for (auto n : bench::sizes(5, 7))
+	{
+		// keys are drawn from [0, 3n/2), split so the two trees overlap
+		// in about half of their values.
+		std::vector<int> keys(n + n / 2);
+		for (std::size_t index = 0; index < keys.size(); index++)
+		{
+			keys[index] = static_cast<int>(index);
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937{ 42 });
+		std::vector<int> first_keys(keys.begin(), keys.begin() + n);
+		std::vector<int> second_keys(keys.begin() + n / 2, keys.end());
+		std::sort(first_keys.begin(), first_keys.end());
+		std::sort(second_keys.begin(), second_keys.end());
+		auto first = avl_tree::from_sorted(first_keys.begin(), first_keys.end());
+		auto second = avl_tree::from_sorted(second_keys.begin(), second_keys.end());
+
+		time_operation("insert one at a time", n, first, second, [](avl_tree &target, avl_tree &source) {
+			for (auto &value : source)
+			{
+				target.insert(value);
+			}
+		});
+
+		for (auto threads : bench::thread_counts())
+		{
+			auto suffix = ", " + std::to_string(threads) + " threads";
+			auto count = static_cast<unsigned>(threads);
+			time_operation("union_with" + suffix, n, first, second, [count](avl_tree &target, avl_tree &source) {
+				target.union_with(std::move(source), count);
+			});
+			time_operation("intersect" + suffix, n, first, second, [count](avl_tree &target, avl_tree &source) {
+				target.intersect(source, count);
+			});
+			time_operation("difference" + suffix, n, first, second, [count](avl_tree &target, avl_tree &source) {
+				target.difference(source, count);
+			});
+		}
+	}
+}
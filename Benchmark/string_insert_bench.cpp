@@ -0,0 +1,74 @@
+// Benchmarks for inserting heap allocated strings: copying each one in,
+// moving it in, emplacing it, and try_emplace, along with the number of
+// allocations each insert makes. The strings are longer than any small
+// string buffer so every copy costs an allocation.
+
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace
+{
+	using string_tree = nwacc::tree<std::string, nwacc::avl>;
+
+	std::vector<std::string> make_keys(std::size_t n)
+	{
+		std::mt19937 random{ 42 };
+		std::vector<std::string> keys;
+		keys.reserve(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			// a shuffled number padded out to 32 characters.
+			auto key = std::to_string(random());
+			key.resize(32, '.');
+			keys.push_back(std::move(key));
+		}
+		return keys;
+	}
+
+	template <typename Insert>
+	void time_inserts(const std::string &name, const std::vector<std::string> &keys, Insert insert)
+	{
+		// the keys are copied up front, outside the timed region, so the
+		// move cases have something to move from.
+		auto input = keys;
+		string_tree bst;
+		auto before = bench::allocations();
+		bench::stopwatch timer;
+		for (auto &key : input)
+		{
+			insert(bst, key);
+		}
+		auto seconds = timer.seconds();
+		auto made = bench::allocations() - before;
+		bench::report(name, keys.size(), keys.size(), seconds);
+		std::cout << "    " << static_cast<double>(made) / keys.size() << " allocations/insert\n";
+		bench::consume(bst.size());
+	}
+}
+
+BENCHMARK(string_insert)
+{
+	for (auto n : bench::sizes(4, 6))
+	{
+		auto keys = make_keys(n);
+
+		time_inserts("insert(const T &)", keys, [](string_tree &bst, std::string &key) {
+			bst.insert(key);
+		});
+		time_inserts("insert(T &&)", keys, [](string_tree &bst, std::string &key) {
+			bst.insert(std::move(key));
+		});
+		time_inserts("emplace(const char *)", keys, [](string_tree &bst, std::string &key) {
+			bst.emplace(key.c_str());
+		});
+		time_inserts("try_emplace(key, std::move(key))", keys, [](string_tree &bst, std::string &key) {
+			bst.try_emplace(key, std::move(key));
+		});
+	}
+}
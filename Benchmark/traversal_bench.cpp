@@ -0,0 +1,193 @@
+// Benchmarks for the whole-tree walks of nwacc::tree: printing in each
+// order, scanning with iterators, cloning and tearing down. Also times the
+// same on degenerate (linked list shaped) trees, and checks that a chain
+// 10^7 nodes deep, far past where the recursive versions overflowed the
+// stack, can be cloned, walked, searched and destroyed.
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <ostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace nwacc
+{
+	template <typename Tree>
+	struct tree_access
+	{
+		/**
+		 * Link the values 0 to n - 1 into an empty tree as a chain of right
+		 * children, 0 at the root, in O(n) rather than the O(n^2) of
+		 * inserting them in order.
+		 */
+		static void build_chain(Tree &bst, int n)
+		{
+			typename Tree::node *parent = nullptr;
+			auto **link = &bst.root;
+			for (auto value = 0; value < n; value++)
+			{
+				auto *current = bst.create_node(parent, value);
+				current->size = static_cast<std::size_t>(n - value);
+				*link = current;
+				link = &current->right;
+				parent = current;
+			}
+		}
+	};
+}
+
+namespace
+{
+	/**
+	 * A stream buffer that throws everything away, so printing measures
+	 * the traversal and formatting rather than the terminal.
+	 */
+	class discard_buffer : public std::streambuf
+	{
+	protected:
+		int overflow(int character) override
+		{
+			return character;
+		}
+
+		std::streamsize xsputn(const char *, std::streamsize count) override
+		{
+			return count;
+		}
+	};
+
+	// deep enough to overflow any thread's stack if anything recursed.
+	const int kChainDepth = 10000000;
+
+	template <typename Tree>
+	void time_walks(const std::string &name, Tree &bst, std::size_t n)
+	{
+		discard_buffer buffer;
+		std::ostream out{ &buffer };
+
+		bench::stopwatch timer;
+		bst.print(out);
+		bench::report(name + " print (pre-order)", n, n, timer.seconds());
+
+		timer.restart();
+		bst.print_in_order(out);
+		bench::report(name + " print_in_order", n, n, timer.seconds());
+
+		timer.restart();
+		bst.print_post_order(out);
+		bench::report(name + " print_post_order", n, n, timer.seconds());
+
+		std::size_t total = 0;
+		timer.restart();
+		for (auto value : bst)
+		{
+			total += value;
+		}
+		bench::report(name + " iterator scan", n, n, timer.seconds());
+		bench::consume(total);
+
+		timer.restart();
+		{
+			auto copy = bst;
+			bench::report(name + " clone", n, n, timer.seconds());
+			timer.restart();
+		}
+		bench::report(name + " destroy", n, n, timer.seconds());
+	}
+}
+
+BENCHMARK(tree_traversals)
+{
+	for (auto n : bench::sizes(4, 6))
+	{
+		std::vector<int> keys(n);
+		std::iota(keys.begin(), keys.end(), 0);
+		std::shuffle(keys.begin(), keys.end(), std::mt19937{ 42 });
+		nwacc::tree<int, nwacc::avl> bst;
+		for (auto key : keys)
+		{
+			bst.insert(key);
+		}
+		time_walks("tree<avl>", bst, n);
+	}
+}
+
+BENCHMARK(tree_degenerate)
+{
+	for (auto n : bench::sizes(4, 7))
+	{
+		// what inserting 0 to n - 1 in order builds, linked directly.
+		nwacc::tree<int> bst;
+		bench::stopwatch timer;
+		nwacc::tree_access<nwacc::tree<int>>::build_chain(bst, static_cast<int>(n));
+		bench::report("tree<unbalanced> degenerate build", n, n, timer.seconds());
+		bench::consume(static_cast<std::size_t>(bst.height()));
+		time_walks("tree<unbalanced> degenerate", bst, n);
+	}
+}
+
+/**
+ * Build a chain kChainDepth nodes deep, clone it, walk the clone in every
+ * order, search and remove at the bottom of it and destroy both, checking
+ * the results along the way. Ignores --max, as the depth is the point.
+ */
+BENCHMARK(tree_deep_teardown)
+{
+	const auto n = static_cast<std::size_t>(kChainDepth);
+	std::size_t wrong = 0;
+	bench::stopwatch timer;
+	{
+		nwacc::tree<int> chain;
+		nwacc::tree_access<nwacc::tree<int>>::build_chain(chain, kChainDepth);
+		wrong += chain.size() != n;
+		wrong += chain.height() != kChainDepth;
+
+		timer.restart();
+		{
+			auto copy = chain;
+			bench::report("tree<unbalanced> deep clone", n, n, timer.seconds());
+			wrong += copy.size() != n;
+			wrong += copy.height() != kChainDepth;
+
+			timer.restart();
+			auto expected = 0;
+			for (auto value : copy)
+			{
+				wrong += value != expected++;
+			}
+			wrong += expected != kChainDepth;
+			bench::report("tree<unbalanced> deep iterator scan", n, n, timer.seconds());
+
+			discard_buffer buffer;
+			std::ostream out{ &buffer };
+			timer.restart();
+			copy.print(out);
+			copy.print_in_order(out);
+			copy.print_post_order(out);
+			bench::report("tree<unbalanced> deep print, all orders", n, 3 * n, timer.seconds());
+
+			wrong += !copy.contains(kChainDepth - 1);
+			wrong += copy.contains(kChainDepth);
+			copy.remove(kChainDepth - 1);
+			copy.remove(0);
+			wrong += copy.size() != n - 2;
+			wrong += copy.contains(kChainDepth - 1) || copy.contains(0);
+			timer.restart();
+		}
+		bench::report("tree<unbalanced> deep destroy", n, n, timer.seconds());
+		timer.restart();
+	}
+	bench::report("tree<unbalanced> deep destroy original", n, n, timer.seconds());
+	if (wrong != 0)
+	{
+		std::cerr << "tree_deep_teardown FAILED: " << wrong << " checks\n";
+		std::exit(1);
+	} // else, every check passed, do_nothing();
+}
@@ -0,0 +1,51 @@
+// Benchmarks for nwacc::tree.
+
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace
+{
+	// Sorted input makes an unbalanced tree quadratic, and the recursive
+	// teardown overflows the stack long before 10^6 keys.
+	const std::size_t kUnbalancedSortedLimit = 10000;
+
+	template <typename Tree>
+	void sorted_insert_contains(const std::string &name, std::size_t n)
+	{
+		Tree bst;
+		bench::stopwatch timer;
+		for (std::size_t key = 0; key < n; key++)
+		{
+			bst.insert(static_cast<int>(key));
+		}
+		bench::report(name + " sorted insert", n, n, timer.seconds());
+
+		std::size_t found = 0;
+		timer.restart();
+		for (std::size_t key = 0; key < n; key++)
+		{
+			found += bst.contains(static_cast<int>(key));
+		}
+		bench::report(name + " sorted contains", n, n, timer.seconds());
+		bench::consume(found);
+	}
+}
+
+BENCHMARK(tree_sorted_input)
+{
+	for (auto n : bench::sizes(3, 6))
+	{
+		sorted_insert_contains<nwacc::tree<int, nwacc::avl>>("tree<avl>", n);
+		if (n <= kUnbalancedSortedLimit)
+		{
+			sorted_insert_contains<nwacc::tree<int>>("tree<unbalanced>", n);
+		}
+		else
+		{
+			bench::skip("tree<unbalanced>", n, "quadratic on sorted input");
+		}
+	}
+}
@@ -0,0 +1,112 @@
+// Benchmarks for keeping a payload with each key: a tree of keys with the
+// payloads in a side std::unordered_map, against a tree_map holding both.
+// Reports the bytes allocated per entry and the cost of a lookup, with
+// the queries arriving as std::string and as const char *.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+#include "tree_map.h"
+
+namespace
+{
+	using key_tree = nwacc::tree<std::string, nwacc::avl>;
+	using side_map = std::unordered_map<std::string, std::size_t>;
+	using string_map = nwacc::tree_map<std::string, std::size_t, std::less<>>;
+
+	std::vector<std::string> make_keys(std::size_t n)
+	{
+		std::mt19937 random{ 42 };
+		std::vector<std::string> keys;
+		keys.reserve(n);
+		for (std::size_t index = 0; index < n; index++)
+		{
+			// a distinct number padded out past the small string buffer.
+			auto key = std::to_string(index * 2654435761u % 4294967291u);
+			key.resize(32, '.');
+			keys.push_back(std::move(key));
+		}
+		std::shuffle(keys.begin(), keys.end(), random);
+		return keys;
+	}
+
+	void report_memory(const std::string &name, std::size_t n, std::size_t bytes)
+	{
+		std::cout << "    " << name << ": " << static_cast<double>(bytes) / n << " bytes/entry\n";
+	}
+
+	template <typename Lookup>
+	void time_lookups(const std::string &name, std::size_t n, Lookup lookup)
+	{
+		auto before = bench::allocations();
+		bench::stopwatch timer;
+		std::size_t found = 0;
+		for (std::size_t index = 0; index < n; index++)
+		{
+			found += lookup(index);
+		}
+		auto seconds = timer.seconds();
+		auto made = bench::allocations() - before;
+		bench::report(name, n, n, seconds);
+		std::cout << "    " << static_cast<double>(made) / n << " allocations/lookup\n";
+		bench::consume(found);
+	}
+}
+
+BENCHMARK(tree_map_lookup)
+{
+	for (auto n : bench::sizes(4, 6))
+	{
+		auto keys = make_keys(n);
+		auto queries = keys;
+		std::shuffle(queries.begin(), queries.end(), std::mt19937{ 7 });
+		std::vector<const char *> raw_queries;
+		for (auto &query : queries)
+		{
+			raw_queries.push_back(query.c_str());
+		}
+
+		auto before = bench::allocated_bytes();
+		key_tree ordered;
+		side_map payloads;
+		for (std::size_t index = 0; index < n; index++)
+		{
+			ordered.insert(keys[index]);
+			payloads.emplace(keys[index], index);
+		}
+		report_memory("tree + side map", n, bench::allocated_bytes() - before);
+
+		before = bench::allocated_bytes();
+		string_map map;
+		for (std::size_t index = 0; index < n; index++)
+		{
+			map.insert_or_assign(keys[index], index);
+		}
+		report_memory("tree_map", n, bench::allocated_bytes() - before);
+
+		time_lookups("tree + side map, std::string", n, [&](std::size_t index) -> std::size_t {
+			auto &query = queries[index];
+			return ordered.contains(query) ? payloads.find(query)->second : 0;
+		});
+		time_lookups("tree + side map, const char *", n, [&](std::size_t index) -> std::size_t {
+			// both containers need a std::string to search with.
+			std::string query{ raw_queries[index] };
+			return ordered.contains(query) ? payloads.find(query)->second : 0;
+		});
+		time_lookups("tree_map, std::string", n, [&](std::size_t index) -> std::size_t {
+			auto found = map.find(queries[index]);
+			return found != map.end() ? found->second : 0;
+		});
+		time_lookups("tree_map, const char *", n, [&](std::size_t index) -> std::size_t {
+			auto found = map.find(raw_queries[index]);
+			return found != map.end() ? found->second : 0;
+		});
+	}
+}
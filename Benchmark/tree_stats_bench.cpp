@@ -0,0 +1,76 @@
+// Shows what tree::stats reports for a healthy and a degenerate tree:
+// an AVL tree and an unbalanced tree fed sorted and uniform keys, then
+// queried. Lookups are timed too, so comparing a build with
+// NWACC_TREE_STATS against one without shows what the counters cost.
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.h"
+#include "tree.h"
+
+namespace
+{
+	template <typename Tree>
+	void run(const std::string &label, std::size_t n, bench::distribution keys_from)
+	{
+		auto keys = bench::make_keys(keys_from, n);
+		auto queries = keys;
+		std::shuffle(queries.begin(), queries.end(), std::mt19937{ 7 });
+
+		Tree values;
+		for (auto key : keys)
+		{
+			values.insert(key);
+		}
+
+		bench::stopwatch timer;
+		std::size_t found = 0;
+		for (auto query : queries)
+		{
+			found += values.contains(query);
+		}
+		auto seconds = timer.seconds();
+		bench::consume(found);
+
+		auto name = label + " " + bench::to_string(keys_from) + " contains";
+		bench::report(name, n, n, seconds);
+		auto stats = values.stats();
+		std::cout << "    height " << stats.height << ", average depth " << stats.average_depth();
+		if (stats.counters_enabled)
+		{
+			std::cout << ", " << stats.comparisons_per_lookup() << " comparisons/lookup, "
+				<< stats.lookup_latency.samples << " latency samples, max "
+				<< stats.lookup_latency.max_nanoseconds << " ns";
+		} // else, built without NWACC_TREE_STATS, do_nothing();
+		std::cout << '\n';
+	}
+}
+
+BENCHMARK(tree_stats)
+{
+	for (auto n : bench::sizes(3, 5))
+	{
+		for (auto keys_from : { bench::distribution::sorted, bench::distribution::uniform })
+		{
+			run<nwacc::tree<int, nwacc::avl>>("tree<avl>", n, keys_from);
+			run<nwacc::tree<int>>("tree<unbalanced>", n, keys_from);
+		}
+	}
+
+	// what a scraper would see for a small tree.
+	nwacc::tree<int, nwacc::avl> values;
+	for (auto key = 0; key < 100; key++)
+	{
+		values.insert(key);
+		values.contains(key / 2);
+	}
+	std::ostringstream text;
+	nwacc::dump(values.stats(), text);
+	std::cout << text.str().substr(0, text.str().find("_latency")) << "...\n";
+}
@@ -0,0 +1,90 @@
+// Benchmarks for unrolled_list against linked_list and std::list:
+// appending, walking every value, inserting a run of values in the
+// middle of the list, and inserting at random positions found by walking
+// from the front. The append lines also report the bytes the list holds
+// per element.
+
+#include <cstddef>
+#include <iostream>
+#include <list>
+#include <random>
+#include <string>
+
+#include "bench.h"
+#include "linked_list.h"
+#include "unrolled_list.h"
+
+namespace
+{
+	const std::size_t kMiddleInserts = 100000;
+	const std::size_t kRandomInserts = 1000;
+	// a walk to a random position is linear; stop at this much work.
+	const std::size_t kWalkBudget = 200000000;
+
+	template <typename List>
+	typename List::iterator walk(List &list, std::size_t steps)
+	{
+		auto position = list.begin();
+		for (std::size_t step = 0; step < steps; step++)
+		{
+			++position;
+		}
+		return position;
+	}
+
+	template <typename List>
+	void run(const std::string &label, std::size_t n)
+	{
+		auto bytes = bench::allocated_bytes();
+		List list;
+		bench::stopwatch timer;
+		for (std::size_t index = 0; index < n; index++)
+		{
+			list.push_back(static_cast<int>(index));
+		}
+		bench::report(label + " push_back", n, n, timer.seconds());
+		std::cout << "    " << static_cast<double>(bench::allocated_bytes() - bytes) / n << " bytes per element\n";
+
+		timer.restart();
+		std::size_t sum = 0;
+		for (auto value : list)
+		{
+			sum += static_cast<std::size_t>(value);
+		}
+		bench::report(label + " iterate", n, n, timer.seconds());
+		bench::consume(sum);
+
+		auto position = walk(list, n / 2);
+		timer.restart();
+		for (std::size_t index = 0; index < kMiddleInserts; index++)
+		{
+			position = list.insert(position, static_cast<int>(index));
+		}
+		bench::report(label + " insert in the middle", n, kMiddleInserts, timer.seconds());
+
+		if (n * kRandomInserts > kWalkBudget)
+		{
+			bench::skip(label + " walk and insert", n, "each insert walks the list");
+			return;
+		} // else, small enough to walk.
+
+		std::mt19937 random{ 11 };
+		timer.restart();
+		for (std::size_t index = 0; index < kRandomInserts; index++)
+		{
+			auto steps = random() % static_cast<std::size_t>(list.size());
+			list.insert(walk(list, steps), static_cast<int>(index));
+		}
+		bench::report(label + " walk and insert", n, kRandomInserts, timer.seconds());
+	}
+}
+
+BENCHMARK(unrolled_list)
+{
+	for (auto n : bench::sizes(3, 7))
+	{
+		run<nwacc::unrolled_list<int>>("unrolled_list", n);
+		run<nwacc::linked_list<int>>("linked_list", n);
+		run<std::list<int>>("std::list", n);
+	}
+}
@@ -2,62 +2,134 @@
 #define ARRAY_LIST_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 
 namespace nwacc
 {
+	/**
+	 * Room for Capacity elements inside the list object itself. Nothing is
+	 * constructed in it until an element is placed there. With a capacity
+	 * of zero this is empty and takes no space in the list.
+	 */
+	template <typename T, int Capacity>
+	struct inline_buffer
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[Capacity];
+
+		T *inline_data()
+		{
+			return reinterpret_cast<T *>(this->slots);
+		}
+	};
+
 	template <typename T>
-	class array_list
+	struct inline_buffer<T, 0>
+	{
+		T *inline_data()
+		{
+			return nullptr;
+		}
+	};
+
+	/**
+	 * A growable array. Storage is raw memory from malloc, and elements are
+	 * only constructed in the slots that are in use, so growing never
+	 * default constructs anything. When the list grows its elements are
+	 * relocated: trivially copyable elements in one realloc, which can
+	 * often extend the block in place (or, for big blocks, remap its pages)
+	 * without copying, anything else by moving each element across.
+	 *
+	 * The first InlineCapacity elements live inside the list object itself,
+	 * so a list that stays that small never touches the heap.
+	 *
+	 * The elements are contiguous and the iterators are plain pointers, so
+	 * they work with every standard algorithm, including the parallel ones.
+	 * Anything that changes the capacity invalidates them.
+	 */
+	template <typename T, int InlineCapacity = 0>
+	class array_list : private inline_buffer<T, InlineCapacity>
 	{
 	public:
+		using value_type = T;
+		using reference = T &;
+		using const_reference = const T &;
+		using iterator = T *;
+		using const_iterator = const T *;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+		using difference_type = std::ptrdiff_t;
+		using size_type = int;
 
-		explicit array_list(int capacity = kDefaultCapacity) :
-		my_size { 0 }, capacity { capacity >= kDefaultCapacity ? capacity : kDefaultCapacity }
+		explicit array_list(int capacity = 0) :
+		my_size { 0 }, capacity { InlineCapacity }, elements { this->inline_data() }
 		{
-			this->data = new T[this->capacity];
+			static_assert(InlineCapacity >= 0, "the inline capacity cannot be negative");
+			static_assert(alignof(T) <= alignof(std::max_align_t), "malloc cannot align the elements");
+			this->reserve(capacity);
 		}
 
-		// copy constructor. 
+		// copy constructor.
 		array_list(const array_list &rhs) :
-		my_size { rhs.my_size }, capacity { rhs.capacity }, data { nullptr }
+		my_size { 0 }, capacity { InlineCapacity }, elements { this->inline_data() }
 		{
-			this->data = new T[this->capacity];
-			for (auto index = 0; index < this->my_size; index++)
+			this->reserve(rhs.my_size);
+			try
+			{
+				std::uninitialized_copy(rhs.elements, rhs.elements + rhs.my_size, this->elements);
+			}
+			catch (...)
 			{
-				this->data[index] = rhs.data[index];
+				this->release(this->elements);
+				throw;
 			}
+			this->my_size = rhs.my_size;
 		}
 
-		array_list(array_list &&rhs) :
-		my_size { rhs.my_size }, capacity { rhs.capacity }, data { rhs.data }
+		array_list(array_list &&rhs) noexcept(kNothrowRelocate) :
+		my_size { 0 }, capacity { InlineCapacity }, elements { this->inline_data() }
 		{
-			rhs.data = nullptr;
-			rhs.my_size = 0;
-			rhs.capacity = 0;
+			this->take(rhs);
 		}
 
 		~array_list()
 		{
-			delete[] this->data;
+			this->clear();
+			this->release(this->elements);
 		}
 
 		void push_back(T &&value)
 		{
-			if (this->size() == this->capacity)
-			{
-				this->reserve();
-			} // else, my_size is within range, do_nothing();
-			this->data[this->my_size++] = std::move(value);
+			this->emplace_back(std::move(value));
 		}
 
 		void push_back(const T &value)
+		{
+			this->emplace_back(value);
+		}
+
+		/**
+		 * Construct a value in place at the end of the list from args and
+		 * return it. args may refer to an element of this list.
+		 */
+		template <typename... Args>
+		T &emplace_back(Args &&... args)
 		{
 			if (this->size() == this->capacity)
 			{
-				this->reserve();
+				return this->grow_and_emplace(std::forward<Args>(args)...);
 			} // else my_size is within range, do_nothing();
 
-			this->data[this->my_size++] = value;
+			auto *value = ::new (static_cast<void *>(this->elements + this->my_size)) T(std::forward<Args>(args)...);
+			this->my_size++;
+			return *value;
 		}
 
 		bool is_empty() const
@@ -67,7 +139,7 @@ namespace nwacc
 
 		/**
 		 * Summary
-		 * @return what does this return. 
+		 * @return what does this return.
 		 */
 		int size() const
 		{
@@ -79,6 +151,269 @@ namespace nwacc
 			return this->capacity;
 		}
 
+		/**
+		 * Return the element at index, which must be in range.
+		 */
+		T &operator[](int index)
+		{
+			return this->elements[index];
+		}
+
+		const T &operator[](int index) const
+		{
+			return this->elements[index];
+		}
+
+		/**
+		 * Return the element at index, or throw std::out_of_range if there
+		 * is no such element.
+		 */
+		T &at(int index)
+		{
+			this->check_index(index);
+			return this->elements[index];
+		}
+
+		const T &at(int index) const
+		{
+			this->check_index(index);
+			return this->elements[index];
+		}
+
+		T &front()
+		{
+			if (this->is_empty())
+			{
+				throw std::out_of_range("No elements in the array list");
+			} // else, we are not empty, do_nothing();
+
+			return this->elements[0];
+		}
+
+		const T &front() const
+		{
+			if (this->is_empty())
+			{
+				throw std::out_of_range("No elements in the array list");
+			} // else, we are not empty, do_nothing();
+
+			return this->elements[0];
+		}
+
+		T &back()
+		{
+			if (this->is_empty())
+			{
+				throw std::out_of_range("No elements in the array list");
+			} // else, we are not empty, do_nothing();
+
+			return this->elements[this->my_size - 1];
+		}
+
+		/**
+		 * Return the underlying array, which holds size() elements.
+		 */
+		T *data()
+		{
+			return this->elements;
+		}
+
+		const T *data() const
+		{
+			return this->elements;
+		}
+
+		iterator begin()
+		{
+			return this->elements;
+		}
+
+		const_iterator begin() const
+		{
+			return this->elements;
+		}
+
+		iterator end()
+		{
+			return this->elements + this->my_size;
+		}
+
+		const_iterator end() const
+		{
+			return this->elements + this->my_size;
+		}
+
+		const_iterator cbegin() const
+		{
+			return this->begin();
+		}
+
+		const_iterator cend() const
+		{
+			return this->end();
+		}
+
+		reverse_iterator rbegin()
+		{
+			return reverse_iterator(this->end());
+		}
+
+		const_reverse_iterator rbegin() const
+		{
+			return const_reverse_iterator(this->end());
+		}
+
+		reverse_iterator rend()
+		{
+			return reverse_iterator(this->begin());
+		}
+
+		const_reverse_iterator rend() const
+		{
+			return const_reverse_iterator(this->begin());
+		}
+
+		/**
+		 * Construct a value from args in front of position and return an
+		 * iterator to it. It is built at the end and rotated into place, so
+		 * the elements after position each move once.
+		 */
+		template <typename... Args>
+		iterator emplace(const_iterator position, Args &&... args)
+		{
+			auto offset = position - this->cbegin();
+			this->emplace_back(std::forward<Args>(args)...);
+			std::rotate(this->begin() + offset, this->end() - 1, this->end());
+			return this->begin() + offset;
+		}
+
+		iterator insert(const_iterator position, const T &value)
+		{
+			return this->emplace(position, value);
+		}
+
+		iterator insert(const_iterator position, T &&value)
+		{
+			return this->emplace(position, std::move(value));
+		}
+
+		/**
+		 * Insert copies of [first, last), which must not be part of this
+		 * list, in front of position and return an iterator to the first one.
+		 * The new values are appended, growing the storage once if the range
+		 * can be measured, and then rotated into place. If copying one of
+		 * them throws, the list is left as it was.
+		 */
+		template <typename InputIterator, typename = typename std::iterator_traits<InputIterator>::iterator_category>
+		iterator insert(const_iterator position, InputIterator first, InputIterator last)
+		{
+			auto offset = position - this->cbegin();
+			auto old_size = this->my_size;
+			this->reserve_for(first, last, typename std::iterator_traits<InputIterator>::iterator_category{});
+			try
+			{
+				for (; first != last; ++first)
+				{
+					this->emplace_back(*first);
+				}
+			}
+			catch (...)
+			{
+				this->truncate(old_size);
+				throw;
+			}
+			std::rotate(this->begin() + offset, this->begin() + old_size, this->end());
+			return this->begin() + offset;
+		}
+
+		/**
+		 * Remove the element at position and return an iterator to the one
+		 * that followed it.
+		 */
+		iterator erase(const_iterator position)
+		{
+			return this->erase(position, position + 1);
+		}
+
+		/**
+		 * Remove [first, last), moving the elements after it down, and
+		 * return an iterator to the element that followed the range.
+		 */
+		iterator erase(const_iterator first, const_iterator last)
+		{
+			auto *target = this->begin() + (first - this->cbegin());
+			if (first != last)
+			{
+				auto *source = this->begin() + (last - this->cbegin());
+				this->truncate(static_cast<int>(std::move(source, this->end(), target) - this->begin()));
+			} // else, nothing to remove, do_nothing();
+
+			return target;
+		}
+
+		/**
+		 * Make the list hold size elements, removing them from the end or
+		 * adding value initialized ones.
+		 */
+		void resize(int size)
+		{
+			this->resize_with(size);
+		}
+
+		/**
+		 * Make the list hold size elements, removing them from the end or
+		 * adding copies of value.
+		 */
+		void resize(int size, const T &value)
+		{
+			if (size > this->capacity)
+			{
+				// value may be one of our elements, which growing moves.
+				T copy(value);
+				this->reserve(this->next_capacity(size));
+				this->resize_with(size, copy);
+				return;
+			} // else, nothing moves, do_nothing();
+
+			this->resize_with(size, value);
+		}
+
+		/**
+		 * Make room for at least capacity elements, so that many can be
+		 * added without moving anything again.
+		 */
+		void reserve(int capacity)
+		{
+			if (capacity <= this->capacity)
+			{
+				return;
+			} // else, we need to change the capacity do_nothing();
+
+			this->reallocate(capacity);
+		}
+
+		/**
+		 * Give back the capacity that is not in use. A list that fits in the
+		 * inline buffer moves back into it.
+		 */
+		void shrink_to_fit()
+		{
+			if (this->is_inline() || this->capacity == this->size())
+			{
+				return;
+			} // else, there is spare room to give back.
+
+			this->reallocate(this->size());
+		}
+
+		/**
+		 * Destroy every element, keeping the capacity.
+		 */
+		void clear()
+		{
+			this->truncate(0);
+		}
+
 		array_list &operator=(const array_list &rhs)
 		{
 			auto copy = rhs;
@@ -86,11 +421,17 @@ namespace nwacc
 			return *this;
 		}
 
-		array_list &operator=(array_list &&rhs)
+		array_list &operator=(array_list &&rhs) noexcept(kNothrowRelocate)
 		{
-			std::swap(this->my_size, rhs.my_size);
-			std::swap(this->capacity, rhs.capacity);
-			std::swap(this->data, rhs.data);
+			if (this != &rhs)
+			{
+				this->clear();
+				this->release(this->elements);
+				this->capacity = InlineCapacity;
+				this->elements = this->inline_data();
+				this->take(rhs);
+			} // else, moving onto ourselves, do_nothing();
+
 			return *this;
 		}
 
@@ -102,6 +443,7 @@ namespace nwacc
 			} // else, we are not empty do_nothing();
 
 			this->my_size--;
+			this->elements[this->my_size].~T();
 		}
 
 		const T & back() const
@@ -111,39 +453,303 @@ namespace nwacc
 				throw std::out_of_range("No elements in the array list");
 			} // else, we are not empty, do_nothing();
 
-			return this->data[this->my_size - 1];
+			return this->elements[this->my_size - 1];
 		}
 
 	private:
 		static const int kDefaultCapacity = 16;
 
+		// elements that can be moved with memcpy and realloc.
+		static const bool kTriviallyRelocatable = std::is_trivially_copyable<T>::value;
+		static const bool kNothrowRelocate = InlineCapacity == 0 || std::is_nothrow_move_constructible<T>::value;
+
 		/*
 		* what is this attribute
 		*/
 		int my_size;
 		int capacity;
-		T * data;
+		// the inline buffer or a block from malloc.
+		T * elements;
 
-		void reserve()
+		void check_index(int index) const
 		{
-			if (this->size() < this->capacity)
+			if (index < 0 || index >= this->my_size)
 			{
+				throw std::out_of_range("Index out of range in array list");
+			} // else, the index is valid, do_nothing();
+		}
+
+		/**
+		 * Destroy the elements from size on.
+		 */
+		void truncate(int size)
+		{
+			destroy(this->elements + size, this->elements + this->my_size);
+			this->my_size = size;
+		}
+
+		/**
+		 * Return the capacity to grow to when at least needed elements have
+		 * to fit.
+		 */
+		int next_capacity(int needed) const
+		{
+			// NOTE - Magic numbers here are fine! realloc can often extend a
+			// block where it lies, so trivially relocatable elements grow by
+			// half and waste less memory; anything else has to be moved one
+			// element at a time, so it doubles to move each element less often.
+			auto grown = kTriviallyRelocatable ? (this->capacity * 3) / 2 + 1 : this->capacity * 2;
+			return std::max(std::max(grown, needed), static_cast<int>(kDefaultCapacity));
+		}
+
+		/**
+		 * Grow once for a range whose length is known up front; a single
+		 * pass range just grows as it is appended.
+		 */
+		template <typename ForwardIterator>
+		void reserve_for(ForwardIterator first, ForwardIterator last, std::forward_iterator_tag)
+		{
+			auto needed = this->my_size + static_cast<int>(std::distance(first, last));
+			if (needed > this->capacity)
+			{
+				this->reserve(this->next_capacity(needed));
+			} // else, it already fits, do_nothing();
+		}
+
+		template <typename InputIterator>
+		void reserve_for(InputIterator, InputIterator, std::input_iterator_tag) {}
+
+		/**
+		 * Shrink to size or grow to it, constructing each new element from
+		 * args.
+		 */
+		template <typename... Args>
+		void resize_with(int size, const Args &... args)
+		{
+			if (size <= this->my_size)
+			{
+				this->truncate(std::max(size, 0));
 				return;
-			} // else, we need to change the capacity do_nothing();
+			}
+			else if (size > this->capacity)
+			{
+				this->reserve(this->next_capacity(size));
+			} // else, there is room already, do_nothing();
+
+			auto old_size = this->my_size;
+			try
+			{
+				for (; this->my_size < size; this->my_size++)
+				{
+					::new (static_cast<void *>(this->elements + this->my_size)) T(args...);
+				}
+			}
+			catch (...)
+			{
+				this->truncate(old_size);
+				throw;
+			}
+		}
+
+		bool is_inline() const
+		{
+			return this->capacity == InlineCapacity;
+		}
+
+		static T *allocate(int capacity)
+		{
+			auto *block = std::malloc(static_cast<std::size_t>(capacity) * sizeof(T));
+			if (block == nullptr)
+			{
+				throw std::bad_alloc{};
+			} // else, we have the memory.
+
+			return static_cast<T *>(block);
+		}
+
+		void release(T *block)
+		{
+			if (block != this->inline_data())
+			{
+				std::free(block);
+			} // else, the inline buffer is part of us, do_nothing();
+		}
+
+		static void destroy(T *first, T *last)
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				for (; first != last; ++first)
+				{
+					first->~T();
+				}
+			} // else, nothing to run, do_nothing();
+		}
+
+		/**
+		 * Move count elements into uninitialized memory at target and
+		 * destroy the originals. If a move (or, for types whose move can
+		 * throw, a copy) fails, the originals are left as they were.
+		 */
+		static void relocate(T *source, int count, T *target)
+		{
+			if (kTriviallyRelocatable)
+			{
+				if (count != 0)
+				{
+					std::memcpy(static_cast<void *>(target), static_cast<const void *>(source), static_cast<std::size_t>(count) * sizeof(T));
+				} // else, nothing to copy, do_nothing();
+				return;
+			}
+			else if (std::is_nothrow_move_constructible<T>::value)
+			{
+				// nothing can go wrong, so each original goes as soon as it moves.
+				for (auto index = 0; index < count; index++)
+				{
+					::new (static_cast<void *>(target + index)) T(std::move(source[index]));
+					source[index].~T();
+				}
+				return;
+			} // else, keep the originals until every element is across.
 
-			// NOTE - Magic numbers here are fine! 
-			auto new_capacity = (this->capacity * 3) / 2 + 1;
-			T * new_array = new T[new_capacity];
-			for (auto index = 0; index < this->size(); index++)
+			auto constructed = 0;
+			try
+			{
+				for (; constructed < count; constructed++)
+				{
+					::new (static_cast<void *>(target + constructed)) T(std::move_if_noexcept(source[constructed]));
+				}
+			}
+			catch (...)
 			{
-				new_array[index] = std::move(this->data[index]);
+				destroy(target, target + constructed);
+				throw;
 			}
+			destroy(source, source + count);
+		}
+
+		/**
+		 * Move the elements into storage for exactly capacity elements,
+		 * which must hold them all: the inline buffer if they fit there,
+		 * otherwise a heap block.
+		 */
+		void reallocate(int capacity)
+		{
+			auto *old_elements = this->elements;
+			if (capacity <= InlineCapacity)
+			{
+				if (this->is_inline())
+				{
+					return;
+				} // else, move back in from the heap.
 
+				if (InlineCapacity != 0)
+				{
+					relocate(old_elements, this->my_size, this->inline_data());
+				} // else, capacity is zero so the list is empty, do_nothing();
+				this->elements = this->inline_data();
+				this->capacity = InlineCapacity;
+				std::free(old_elements);
+				return;
+			}
+			else if (kTriviallyRelocatable && !this->is_inline())
+			{
+				auto *block = std::realloc(static_cast<void *>(old_elements), static_cast<std::size_t>(capacity) * sizeof(T));
+				if (block == nullptr)
+				{
+					throw std::bad_alloc{};
+				} // else, realloc moved the bytes for us.
+
+				this->elements = static_cast<T *>(block);
+				this->capacity = capacity;
+				return;
+			} // else, move the elements into a new block.
+
+			auto *new_elements = allocate(capacity);
+			try
+			{
+				relocate(old_elements, this->my_size, new_elements);
+			}
+			catch (...)
+			{
+				std::free(new_elements);
+				throw;
+			}
+			this->elements = new_elements;
+			this->capacity = capacity;
+			this->release(old_elements);
+		}
+
+		/**
+		 * Grow the storage and construct one more element from args at the
+		 * end. The new element is built before the old storage goes away,
+		 * in case args refer to one of the elements.
+		 */
+		template <typename... Args>
+		T &grow_and_emplace(Args &&... args)
+		{
+			auto new_capacity = this->next_capacity(this->my_size + 1);
+			if (kTriviallyRelocatable && !this->is_inline())
+			{
+				T value(std::forward<Args>(args)...);
+				this->reallocate(new_capacity);
+				auto *slot = ::new (static_cast<void *>(this->elements + this->my_size)) T(std::move(value));
+				this->my_size++;
+				return *slot;
+			} // else, build it in the new block, then move the rest across.
+
+			auto *new_elements = allocate(new_capacity);
+			T *slot;
+			try
+			{
+				slot = ::new (static_cast<void *>(new_elements + this->my_size)) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				std::free(new_elements);
+				throw;
+			}
+
+			try
+			{
+				relocate(this->elements, this->my_size, new_elements);
+			}
+			catch (...)
+			{
+				slot->~T();
+				std::free(new_elements);
+				throw;
+			}
+			this->release(this->elements);
+			this->elements = new_elements;
 			this->capacity = new_capacity;
-			std::swap(this->data, new_array);
-			delete[] new_array;
+			this->my_size++;
+			return *slot;
+		}
+
+		/**
+		 * Take the elements of rhs into this list, which must be empty and
+		 * using its inline buffer, stealing the heap block of rhs if it has
+		 * one. rhs is left empty.
+		 */
+		void take(array_list &rhs)
+		{
+			if (rhs.is_inline())
+			{
+				relocate(rhs.elements, rhs.my_size, this->elements);
+				this->my_size = rhs.my_size;
+				rhs.my_size = 0;
+				return;
+			} // else, the block can change hands.
+
+			this->elements = rhs.elements;
+			this->capacity = rhs.capacity;
+			this->my_size = rhs.my_size;
+			rhs.elements = rhs.inline_data();
+			rhs.capacity = InlineCapacity;
+			rhs.my_size = 0;
 		}
 	};
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,936 @@
+#ifndef BPLUS_TREE_H_
+#define BPLUS_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nwacc
+{
+	// the bytes of values each node aims for, eight cache lines.
+	const std::size_t kBPlusNodeBytes = 512;
+
+	/**
+	 * How many values of T fill kBPlusNodeBytes, but never fewer than
+	 * eight.
+	 */
+	template <typename T>
+	constexpr int bplus_fanout()
+	{
+		return kBPlusNodeBytes / sizeof(T) < 8 ? 8 : static_cast<int>(kBPlusNodeBytes / sizeof(T));
+	}
+
+	/**
+	 * A B+ tree: an ordered set of unique values with the insert, remove
+	 * and contains of tree, for sets far bigger than the cache. Every value
+	 * lives in a leaf, packed in an array of up to Fanout of them, and the
+	 * leaves are linked in order so a scan walks arrays rather than
+	 * pointers. Internal nodes hold up to Fanout children and a copy of
+	 * the smallest value under each child but the first to steer by, so a
+	 * lookup reads about log_Fanout(n) nodes, each a few cache lines.
+	 *
+	 * Nodes are kept at least half full: a full node splits in two, and a
+	 * node that drops below half borrows from a sibling or merges with it.
+	 * Any insert or remove invalidates every iterator.
+	 */
+	template <typename T, int Fanout = bplus_fanout<T>(), typename Compare = std::less<T>>
+	class bplus_tree
+	{
+	private:
+		// a leaf holds Fanout values, an internal node Fanout children.
+		using slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+		struct node
+		{
+			// values in a leaf, children in an internal node.
+			int count;
+			bool is_leaf;
+		};
+
+		struct leaf_node : node
+		{
+			slot values[Fanout];
+			leaf_node *previous;
+			leaf_node *next;
+
+			T *data()
+			{
+				return reinterpret_cast<T *>(this->values);
+			}
+		};
+
+		struct internal_node : node
+		{
+			// keys[i] is the smallest value under children[i + 1].
+			slot keys[Fanout - 1];
+			node *children[Fanout];
+
+			T *data()
+			{
+				return reinterpret_cast<T *>(this->keys);
+			}
+		};
+
+	public:
+		/**
+		 * Walks the leaves in order. Values cannot be changed through it,
+		 * as that could break the order.
+		 */
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() : leaf{ nullptr }, index{ 0 } {}
+
+			const T &operator*() const
+			{
+				return this->leaf->data()[this->index];
+			}
+
+			const T *operator->() const
+			{
+				return &this->leaf->data()[this->index];
+			}
+
+			const_iterator &operator++()
+			{
+				if (++this->index == this->leaf->count)
+				{
+					this->leaf = this->leaf->next;
+					this->index = 0;
+				} // else, still in this leaf, do_nothing();
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			bool operator==(const const_iterator &rhs) const
+			{
+				return this->leaf == rhs.leaf && this->index == rhs.index;
+			}
+
+			bool operator!=(const const_iterator &rhs) const
+			{
+				return !(*this == rhs);
+			}
+
+		private:
+			leaf_node *leaf;
+			int index;
+
+			const_iterator(leaf_node *leaf, int index) : leaf{ leaf }, index{ index } {}
+
+			friend class bplus_tree;
+		};
+
+		using iterator = const_iterator;
+
+		explicit bplus_tree(const Compare &compare = Compare()) : root{ nullptr }, my_size{ 0 }, compare{ compare }
+		{
+			static_assert(Fanout >= 4, "a node must split into halves of at least two");
+		}
+
+		// copy constructor, a bulk load of the values in order.
+		bplus_tree(const bplus_tree &rhs) : bplus_tree{ from_sorted(rhs.begin(), rhs.end(), rhs.compare) } {}
+
+		bplus_tree(bplus_tree &&rhs) noexcept : root{ rhs.root }, my_size{ rhs.my_size }, compare{ rhs.compare }
+		{
+			rhs.root = nullptr;
+			rhs.my_size = 0;
+		}
+
+		~bplus_tree()
+		{
+			this->clear();
+		}
+
+		bplus_tree &operator=(bplus_tree rhs)
+		{
+			std::swap(this->root, rhs.root);
+			std::swap(this->my_size, rhs.my_size);
+			std::swap(this->compare, rhs.compare);
+			return *this;
+		}
+
+		/**
+		 * Build a tree from a sorted range in O(n), filling the leaves and
+		 * then each level above them from left to right. Every node is full
+		 * except that the last two on a level share out what is left when
+		 * the last would be less than half full. Repeated values are kept
+		 * once.
+		 */
+		template <typename ForwardIterator>
+		static bplus_tree from_sorted(ForwardIterator first, ForwardIterator last, const Compare &compare = Compare())
+		{
+			bplus_tree result{ compare };
+			auto count = result.count_unique(first, last);
+			if (count == 0)
+			{
+				return result;
+			} // else, there are values to load.
+
+			// reserved, so a leaf is never created without room to record it.
+			std::vector<node *> level;
+			auto leaves = groups(count);
+			level.reserve(leaves);
+			try
+			{
+				result.load_leaves(first, leaves, count, level);
+				result.root = build_levels(level);
+			}
+			catch (...)
+			{
+				// whatever has been built and not yet destroyed is in level.
+				for (auto *current : level)
+				{
+					destroy(current);
+				}
+				throw;
+			}
+			result.my_size = count;
+			return result;
+		}
+
+		/**
+		 * Build a tree from values in any order by sorting a copy of them
+		 * first and then loading that, in O(n log n).
+		 */
+		template <typename InputIterator>
+		static bplus_tree from_unsorted(InputIterator first, InputIterator last, const Compare &compare = Compare())
+		{
+			std::vector<T> values(first, last);
+			std::sort(values.begin(), values.end(), compare);
+			return from_sorted(values.begin(), values.end(), compare);
+		}
+
+		const_iterator begin() const
+		{
+			if (this->root == nullptr)
+			{
+				return this->end();
+			} // else, go down the left edge.
+
+			auto *current = this->root;
+			while (!current->is_leaf)
+			{
+				current = static_cast<internal_node *>(current)->children[0];
+			}
+			return const_iterator(static_cast<leaf_node *>(current), 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator();
+		}
+
+		std::size_t size() const
+		{
+			return this->my_size;
+		}
+
+		bool is_empty() const
+		{
+			return this->my_size == 0;
+		}
+
+		/**
+		 * Return the number of levels, 0 for an empty tree.
+		 */
+		int height() const
+		{
+			auto levels = 0;
+			for (auto *current = this->root; current != nullptr; levels++)
+			{
+				current = current->is_leaf ? nullptr : static_cast<internal_node *>(current)->children[0];
+			}
+			return levels;
+		}
+
+		void clear()
+		{
+			destroy(this->root);
+			this->root = nullptr;
+			this->my_size = 0;
+		}
+
+		/**
+		 * Insert a copy of the value. Return an iterator to the value in the
+		 * tree and whether it was inserted; if an equal value was already
+		 * there, nothing changes and the iterator points at that one. If a
+		 * copy or an allocation throws, the tree is left as it was, as long
+		 * as moving a T does not throw.
+		 */
+		std::pair<iterator, bool> insert(const T &value)
+		{
+			return this->insert_unique(value);
+		}
+
+		std::pair<iterator, bool> insert(T &&value)
+		{
+			return this->insert_unique(std::move(value));
+		}
+
+		/**
+		 * Remove the value if it is in the tree.
+		 */
+		void remove(const T &value)
+		{
+			if (this->root == nullptr)
+			{
+				return;
+			} // else, look for it.
+
+			path_step path[kMaxDepth];
+			auto depth = 0;
+			auto *leaf = this->find_leaf(value, path, depth);
+			auto *data = leaf->data();
+			auto index = this->position(leaf, value);
+			if (index == leaf->count || this->compare(value, data[index]))
+			{
+				return;
+			} // else, found it.
+
+			erase_at(data, leaf->count, index);
+			leaf->count--;
+			this->my_size--;
+			this->rebalance(leaf, path, depth);
+		}
+
+		bool contains(const T &value) const
+		{
+			return this->find(value) != this->end();
+		}
+
+		const_iterator find(const T &value) const
+		{
+			auto found = this->lower_bound(value);
+			if (found == this->end() || this->compare(value, *found))
+			{
+				return this->end();
+			}
+			return found;
+		}
+
+		/**
+		 * Return the first value not less than value.
+		 */
+		const_iterator lower_bound(const T &value) const
+		{
+			if (this->root == nullptr)
+			{
+				return this->end();
+			} // else, go down to the leaf that would hold it.
+
+			path_step path[kMaxDepth];
+			auto depth = 0;
+			auto *leaf = this->find_leaf(value, path, depth);
+			auto index = this->position(leaf, value);
+			if (index == leaf->count)
+			{
+				// everything here is smaller, so the answer starts the next leaf.
+				return const_iterator(leaf->next, 0);
+			}
+			return const_iterator(leaf, index);
+		}
+
+		/**
+		 * Call visit on every value in [low, high), in order, walking the
+		 * leaves from the one low belongs in.
+		 */
+		template <typename Visitor>
+		void for_each_in_range(const T &low, const T &high, Visitor visit) const
+		{
+			auto current = this->lower_bound(low);
+			if (current == this->end())
+			{
+				return;
+			} // else, scan from here.
+
+			auto *leaf = current.leaf;
+			auto index = current.index;
+			for (; leaf != nullptr; leaf = leaf->next, index = 0)
+			{
+				auto *data = leaf->data();
+				for (; index < leaf->count; index++)
+				{
+					if (!this->compare(data[index], high))
+					{
+						return;
+					} // else, still in the range.
+
+					visit(data[index]);
+				}
+			}
+		}
+
+	private:
+		static const int kMinimum = Fanout / 2;
+		// deep enough for any tree that fits in memory, at two children a node.
+		static const int kMaxDepth = 64;
+
+		// an internal node on the way down and which child was taken.
+		struct path_step
+		{
+			internal_node *parent;
+			int index;
+		};
+
+		node *root;
+		std::size_t my_size;
+		Compare compare;
+
+		static leaf_node *create_leaf()
+		{
+			auto *leaf = new leaf_node;
+			leaf->count = 0;
+			leaf->is_leaf = true;
+			leaf->previous = nullptr;
+			leaf->next = nullptr;
+			return leaf;
+		}
+
+		static internal_node *create_internal()
+		{
+			auto *internal = new internal_node;
+			internal->count = 0;
+			internal->is_leaf = false;
+			return internal;
+		}
+
+		static void destroy(node *current)
+		{
+			if (current == nullptr)
+			{
+				return;
+			}
+			else if (current->is_leaf)
+			{
+				auto *leaf = static_cast<leaf_node *>(current);
+				destroy_values(leaf->data(), leaf->count);
+				delete leaf;
+				return;
+			} // else, destroy the children first.
+
+			auto *internal = static_cast<internal_node *>(current);
+			for (auto index = 0; index < internal->count; index++)
+			{
+				destroy(internal->children[index]);
+			}
+			destroy_values(internal->data(), internal->count - 1);
+			delete internal;
+		}
+
+		static void destroy_values(T *data, int count)
+		{
+			for (auto index = 0; index < count; index++)
+			{
+				data[index].~T();
+			}
+		}
+
+		/**
+		 * Construct a value at the end of an array with room, then rotate it
+		 * into place at index.
+		 */
+		template <typename... Args>
+		static void insert_at(T *data, int count, int index, Args &&... args)
+		{
+			::new (static_cast<void *>(data + count)) T(std::forward<Args>(args)...);
+			std::rotate(data + index, data + count, data + count + 1);
+		}
+
+		static void erase_at(T *data, int count, int index)
+		{
+			std::move(data + index + 1, data + count, data + index);
+			data[count - 1].~T();
+		}
+
+		// move count values into the raw slots at to, destroying the originals.
+		static void relocate(T *from, int count, T *to)
+		{
+			for (auto index = 0; index < count; index++)
+			{
+				::new (static_cast<void *>(to + index)) T(std::move(from[index]));
+				from[index].~T();
+			}
+		}
+
+		static void insert_child(internal_node *parent, int index, node *child)
+		{
+			std::copy_backward(parent->children + index, parent->children + parent->count, parent->children + parent->count + 1);
+			parent->children[index] = child;
+		}
+
+		static void erase_child(internal_node *parent, int index)
+		{
+			std::copy(parent->children + index + 1, parent->children + parent->count, parent->children + index);
+		}
+
+		/**
+		 * Go down to the leaf where value belongs, recording the way in path.
+		 */
+		leaf_node *find_leaf(const T &value, path_step *path, int &depth) const
+		{
+			auto *current = this->root;
+			while (!current->is_leaf)
+			{
+				auto *internal = static_cast<internal_node *>(current);
+				auto *keys = internal->data();
+				// the number of separators not greater than value.
+				auto index = static_cast<int>(std::upper_bound(keys, keys + internal->count - 1, value, this->compare) - keys);
+				path[depth++] = { internal, index };
+				current = internal->children[index];
+			}
+			return static_cast<leaf_node *>(current);
+		}
+
+		// where value is, or would go, in the leaf.
+		int position(leaf_node *leaf, const T &value) const
+		{
+			auto *data = leaf->data();
+			return static_cast<int>(std::lower_bound(data, data + leaf->count, value, this->compare) - data);
+		}
+
+		template <typename Value>
+		std::pair<iterator, bool> insert_unique(Value &&value)
+		{
+			if (this->root == nullptr)
+			{
+				auto *leaf = create_leaf();
+				try
+				{
+					insert_at(leaf->data(), 0, 0, std::forward<Value>(value));
+				}
+				catch (...)
+				{
+					delete leaf;
+					throw;
+				}
+				leaf->count = 1;
+				this->root = leaf;
+				this->my_size = 1;
+				return { iterator(leaf, 0), true };
+			} // else, find the leaf it belongs in.
+
+			path_step path[kMaxDepth];
+			auto depth = 0;
+			auto *leaf = this->find_leaf(value, path, depth);
+			auto *data = leaf->data();
+			auto index = this->position(leaf, value);
+			if (index < leaf->count && !this->compare(value, data[index]))
+			{
+				return { iterator(leaf, index), false };
+			}
+			else if (leaf->count < Fanout)
+			{
+				insert_at(data, leaf->count, index, std::forward<Value>(value));
+				leaf->count++;
+				this->my_size++;
+				return { iterator(leaf, index), true };
+			} // else, the leaf is full and has to split.
+
+			// everything that can throw comes before the leaf is touched: the
+			// new value, a copy of the old value that will start the right
+			// half, and every node the split will need on its way up.
+			T item(std::forward<Value>(value));
+			T separator(data[kMinimum]);
+			internal_node *spares[kMaxDepth + 1];
+			auto needed = spares_needed(path, depth);
+			auto made = 0;
+			leaf_node *right;
+			try
+			{
+				for (; made < needed; made++)
+				{
+					spares[made] = create_internal();
+				}
+				right = create_leaf();
+			}
+			catch (...)
+			{
+				for (auto index = 0; index < made; index++)
+				{
+					delete spares[index];
+				}
+				throw;
+			}
+
+			right->previous = leaf;
+			right->next = leaf->next;
+			if (leaf->next != nullptr)
+			{
+				leaf->next->previous = right;
+			} // else, the new last leaf, do_nothing();
+			leaf->next = right;
+
+			relocate(data + kMinimum, Fanout - kMinimum, right->data());
+			right->count = Fanout - kMinimum;
+			leaf->count = kMinimum;
+
+			iterator result;
+			if (index <= kMinimum)
+			{
+				insert_at(data, leaf->count, index, std::move(item));
+				leaf->count++;
+				result = iterator(leaf, index);
+			}
+			else
+			{
+				insert_at(right->data(), right->count, index - kMinimum, std::move(item));
+				right->count++;
+				result = iterator(right, index - kMinimum);
+			}
+			this->insert_in_parent(right, std::move(separator), path, depth, spares);
+			this->my_size++;
+			return { result, true };
+		}
+
+		/**
+		 * Return how many internal nodes a split of the leaf at the end of
+		 * path will create: one for each full parent above it in a row, and
+		 * a new root if every parent is full.
+		 */
+		static int spares_needed(const path_step *path, int depth)
+		{
+			auto full = 0;
+			while (full < depth && path[depth - 1 - full].parent->count == Fanout)
+			{
+				full++;
+			}
+			return full == depth ? full + 1 : full;
+		}
+
+		/**
+		 * Link a node split off to the right into the parent at the end of
+		 * path, splitting full parents in turn, up to a new root if need be.
+		 * The nodes for that come from spares, in order, so nothing here
+		 * allocates.
+		 */
+		void insert_in_parent(node *child, T separator, path_step *path, int depth, internal_node **spares)
+		{
+			while (depth != 0)
+			{
+				auto step = path[--depth];
+				auto *parent = step.parent;
+				auto *keys = parent->data();
+				if (parent->count < Fanout)
+				{
+					insert_at(keys, parent->count - 1, step.index, std::move(separator));
+					insert_child(parent, step.index + 1, child);
+					parent->count++;
+					return;
+				} // else, the parent is full too.
+
+				// keep kMinimum children, move the key between the halves up.
+				auto *sibling = *spares++;
+				T promoted(std::move(keys[kMinimum - 1]));
+				keys[kMinimum - 1].~T();
+				relocate(keys + kMinimum, Fanout - 1 - kMinimum, sibling->data());
+				std::copy(parent->children + kMinimum, parent->children + Fanout, sibling->children);
+				sibling->count = Fanout - kMinimum;
+				parent->count = kMinimum;
+
+				auto *half = step.index < kMinimum ? parent : sibling;
+				auto index = step.index < kMinimum ? step.index : step.index - kMinimum;
+				insert_at(half->data(), half->count - 1, index, std::move(separator));
+				insert_child(half, index + 1, child);
+				half->count++;
+
+				separator = std::move(promoted);
+				child = sibling;
+			}
+
+			auto *new_root = *spares;
+			::new (static_cast<void *>(new_root->data())) T(std::move(separator));
+			new_root->children[0] = this->root;
+			new_root->children[1] = child;
+			new_root->count = 2;
+			this->root = new_root;
+		}
+
+		/**
+		 * Bring a leaf that has dropped below half full back up, borrowing
+		 * a value from a sibling that can spare one or else merging with
+		 * it, then do the same for each parent that loses a child.
+		 */
+		void rebalance(leaf_node *leaf, path_step *path, int depth)
+		{
+			if (depth == 0)
+			{
+				if (leaf->count == 0)
+				{
+					delete leaf;
+					this->root = nullptr;
+				} // else, a root leaf may hold any number, do_nothing();
+				return;
+			}
+			else if (leaf->count >= kMinimum)
+			{
+				return;
+			} // else, too few values.
+
+			auto step = path[depth - 1];
+			auto *parent = step.parent;
+			auto *keys = parent->data();
+			auto *data = leaf->data();
+			auto *left = step.index > 0 ? static_cast<leaf_node *>(parent->children[step.index - 1]) : nullptr;
+			auto *right = step.index + 1 < parent->count ? static_cast<leaf_node *>(parent->children[step.index + 1]) : nullptr;
+			if (left != nullptr && left->count > kMinimum)
+			{
+				auto *from = left->data();
+				insert_at(data, leaf->count, 0, std::move(from[left->count - 1]));
+				from[--left->count].~T();
+				leaf->count++;
+				keys[step.index - 1] = data[0];
+				return;
+			}
+			else if (right != nullptr && right->count > kMinimum)
+			{
+				auto *from = right->data();
+				::new (static_cast<void *>(data + leaf->count)) T(std::move(from[0]));
+				leaf->count++;
+				erase_at(from, right->count--, 0);
+				keys[step.index] = from[0];
+				return;
+			} // else, neither sibling can spare a value, so merge with one.
+
+			// merge the right one of the pair into the left one.
+			auto separator = left != nullptr ? step.index - 1 : step.index;
+			auto *lower = left != nullptr ? left : leaf;
+			auto *upper = left != nullptr ? leaf : right;
+			relocate(upper->data(), upper->count, lower->data() + lower->count);
+			lower->count += upper->count;
+			lower->next = upper->next;
+			if (upper->next != nullptr)
+			{
+				upper->next->previous = lower;
+			} // else, lower is the last leaf now, do_nothing();
+			delete upper;
+
+			erase_at(keys, parent->count - 1, separator);
+			erase_child(parent, separator + 1);
+			parent->count--;
+			this->rebalance(parent, path, depth - 1);
+		}
+
+		/**
+		 * The same for an internal node, which borrows by rotating a child
+		 * through the parent, and merges by pulling the key between the two
+		 * down from the parent.
+		 */
+		void rebalance(internal_node *current, path_step *path, int depth)
+		{
+			if (depth == 0)
+			{
+				if (current->count == 1)
+				{
+					// the root has one child left, which becomes the root.
+					this->root = current->children[0];
+					delete current;
+				} // else, a root may have as few as two children, do_nothing();
+				return;
+			}
+			else if (current->count >= kMinimum)
+			{
+				return;
+			} // else, too few children.
+
+			auto step = path[depth - 1];
+			auto *parent = step.parent;
+			auto *keys = parent->data();
+			auto *data = current->data();
+			auto *left = step.index > 0 ? static_cast<internal_node *>(parent->children[step.index - 1]) : nullptr;
+			auto *right = step.index + 1 < parent->count ? static_cast<internal_node *>(parent->children[step.index + 1]) : nullptr;
+			if (left != nullptr && left->count > kMinimum)
+			{
+				auto *from = left->data();
+				insert_at(data, current->count - 1, 0, std::move(keys[step.index - 1]));
+				insert_child(current, 0, left->children[left->count - 1]);
+				current->count++;
+				keys[step.index - 1] = std::move(from[left->count - 2]);
+				from[left->count - 2].~T();
+				left->count--;
+				return;
+			}
+			else if (right != nullptr && right->count > kMinimum)
+			{
+				auto *from = right->data();
+				::new (static_cast<void *>(data + current->count - 1)) T(std::move(keys[step.index]));
+				current->children[current->count] = right->children[0];
+				current->count++;
+				keys[step.index] = std::move(from[0]);
+				erase_at(from, right->count - 1, 0);
+				erase_child(right, 0);
+				right->count--;
+				return;
+			} // else, neither sibling can spare a child, so merge with one.
+
+			auto separator = left != nullptr ? step.index - 1 : step.index;
+			auto *lower = left != nullptr ? left : current;
+			auto *upper = left != nullptr ? current : right;
+			auto *lower_keys = lower->data();
+			::new (static_cast<void *>(lower_keys + lower->count - 1)) T(std::move(keys[separator]));
+			relocate(upper->data(), upper->count - 1, lower_keys + lower->count);
+			std::copy(upper->children, upper->children + upper->count, lower->children + lower->count);
+			lower->count += upper->count;
+			delete upper;
+
+			erase_at(keys, parent->count - 1, separator);
+			erase_child(parent, separator + 1);
+			parent->count--;
+			this->rebalance(parent, path, depth - 1);
+		}
+
+		template <typename ForwardIterator>
+		std::size_t count_unique(ForwardIterator first, ForwardIterator last) const
+		{
+			std::size_t count = 0;
+			for (auto previous = first; first != last; ++first)
+			{
+				if (count == 0 || this->compare(*previous, *first))
+				{
+					count++;
+				} // else, a repeat, do_nothing();
+				previous = first;
+			}
+			return count;
+		}
+
+		/**
+		 * Fill leaves leaves from the sorted values at first, skipping
+		 * repeats, and link them in order onto level.
+		 */
+		template <typename ForwardIterator>
+		void load_leaves(ForwardIterator first, std::size_t leaves, std::size_t count, std::vector<node *> &level)
+		{
+			leaf_node *previous = nullptr;
+			const T *latest = nullptr;
+			for (std::size_t leaf = 0; leaf < leaves; leaf++)
+			{
+				auto *current = create_leaf();
+				current->previous = previous;
+				if (previous != nullptr)
+				{
+					previous->next = current;
+				} // else, the first leaf, do_nothing();
+				level.push_back(current);
+				previous = current;
+
+				auto *data = current->data();
+				for (auto size = group_size(leaf, leaves, count, kMinimum); current->count < size; ++first)
+				{
+					if (latest != nullptr && !this->compare(*latest, *first))
+					{
+						continue;
+					} // else, not a repeat of the last value loaded.
+
+					::new (static_cast<void *>(data + current->count)) T(*first);
+					latest = data + current->count;
+					current->count++;
+				}
+			}
+		}
+
+		/**
+		 * The number of nodes needed for count items at up to Fanout a node.
+		 */
+		static std::size_t groups(std::size_t count)
+		{
+			return (count + Fanout - 1) / Fanout;
+		}
+
+		/**
+		 * The number of items in node index of groups: Fanout, except that
+		 * the last two split what they hold between them if the last would
+		 * otherwise have fewer than minimum.
+		 */
+		static int group_size(std::size_t index, std::size_t groups, std::size_t count, int minimum)
+		{
+			auto last = static_cast<int>(count - (groups - 1) * Fanout);
+			if (groups == 1 || last >= minimum || index + 2 < groups)
+			{
+				return index + 1 == groups ? last : Fanout;
+			} // else, one of the last two sharing what is left.
+
+			auto shared = Fanout + last;
+			return index + 2 == groups ? shared / 2 : shared - shared / 2;
+		}
+
+		// the smallest value under a node.
+		static const T &smallest(node *current)
+		{
+			while (!current->is_leaf)
+			{
+				current = static_cast<internal_node *>(current)->children[0];
+			}
+			return static_cast<leaf_node *>(current)->data()[0];
+		}
+
+		/**
+		 * Build the internal levels over a level of nodes, returning the root.
+		 * If a copy or an allocation throws, every node built so far is
+		 * destroyed and level is left empty.
+		 */
+		static node *build_levels(std::vector<node *> &level)
+		{
+			while (level.size() > 1)
+			{
+				std::vector<node *> above;
+				auto parents = groups(level.size());
+				above.reserve(parents);
+				std::size_t next = 0;
+				try
+				{
+					for (std::size_t parent = 0; parent < parents; parent++)
+					{
+						above.push_back(create_internal());
+						auto *current = static_cast<internal_node *>(above.back());
+						auto size = group_size(parent, parents, level.size(), kMinimum);
+						for (auto child = 0; child < size; child++, next++)
+						{
+							if (child != 0)
+							{
+								::new (static_cast<void *>(current->data() + child - 1)) T(smallest(level[next]));
+							} // else, the first child needs no key, do_nothing();
+							current->children[child] = level[next];
+							current->count++;
+						}
+					}
+				}
+				catch (...)
+				{
+					// the new parents own the children before next, and a
+					// partly filled one is consistent up to its count.
+					for (auto *current : above)
+					{
+						destroy(current);
+					}
+					for (; next < level.size(); next++)
+					{
+						destroy(level[next]);
+					}
+					level.clear();
+					throw;
+				}
+				level.swap(above);
+			}
+			return level.front();
+		}
+	};
+}
+
+#endif // BPLUS_TREE_H_
@@ -0,0 +1,256 @@
+#ifndef BUFFERED_WRITER_H_
+#define BUFFERED_WRITER_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <charconv>
+#define NWACC_HAS_TO_CHARS 1
+#endif
+
+namespace nwacc
+{
+	/**
+	 * A sink that hands each block of text to an output stream.
+	 */
+	class ostream_sink
+	{
+	public:
+		explicit ostream_sink(std::ostream &out) : out{ &out } {}
+
+		void operator()(const char *data, std::size_t size)
+		{
+			this->out->write(data, static_cast<std::streamsize>(size));
+		}
+
+	private:
+		std::ostream *out;
+	};
+
+	/**
+	 * A sink that copies each block of text through an output iterator,
+	 * such as a std::back_inserter or a pointer into a buffer. position()
+	 * returns the iterator past the last character written.
+	 */
+	template <typename OutputIterator>
+	class iterator_sink
+	{
+	public:
+		explicit iterator_sink(OutputIterator first) : next{ first } {}
+
+		void operator()(const char *data, std::size_t size)
+		{
+			this->next = std::copy(data, data + size, this->next);
+		}
+
+		OutputIterator position() const
+		{
+			return this->next;
+		}
+
+	private:
+		OutputIterator next;
+	};
+
+	template <typename OutputIterator>
+	iterator_sink<OutputIterator> make_iterator_sink(OutputIterator first)
+	{
+		return iterator_sink<OutputIterator>(first);
+	}
+
+	/**
+	 * Formats values as text into a large buffer and passes the buffer to
+	 * a sink only when it fills up or is flushed, so the sink sees a few
+	 * big writes rather than one (or a flush) per value. A sink is any
+	 * callable taking (const char *data, std::size_t size).
+	 *
+	 * Integers are formatted directly into the buffer (with std::to_chars
+	 * when the library has it), strings are copied, and any other type
+	 * goes through its operator<<.
+	 *
+	 * The destructor flushes whatever is left but has to swallow errors
+	 * from the sink; call flush first to see them.
+	 */
+	template <typename Sink>
+	class buffered_writer
+	{
+	public:
+		static const std::size_t kDefaultCapacity = std::size_t{ 1 } << 16;
+
+		explicit buffered_writer(Sink sink, std::size_t capacity = kDefaultCapacity) :
+			output{ std::move(sink) }, buffer(capacity < kMinimumCapacity ? kMinimumCapacity : capacity), used{ 0 } {}
+
+		buffered_writer(const buffered_writer &rhs) = delete;
+		buffered_writer &operator=(const buffered_writer &rhs) = delete;
+
+		~buffered_writer()
+		{
+			try
+			{
+				this->flush();
+			}
+			catch (...)
+			{
+				// nowhere to report it from a destructor. do_nothing();
+			}
+		}
+
+		void put(char character)
+		{
+			if (this->used == this->buffer.size())
+			{
+				this->flush();
+			} // else, there is room, do_nothing();
+
+			this->buffer[this->used++] = character;
+		}
+
+		/**
+		 * Copy size characters in. A block bigger than the whole buffer
+		 * goes straight to the sink.
+		 */
+		void write(const char *data, std::size_t size)
+		{
+			if (size > this->buffer.size() - this->used)
+			{
+				this->flush();
+				if (size >= this->buffer.size())
+				{
+					this->output(data, size);
+					return;
+				} // else, it fits in the empty buffer.
+			} // else, there is room, do_nothing();
+
+			std::memcpy(this->buffer.data() + this->used, data, size);
+			this->used += size;
+		}
+
+		/**
+		 * Format the value as text, the way operator<< would.
+		 */
+		template <typename T>
+		void write_value(const T &value)
+		{
+			this->format(value, std::integral_constant<bool, std::is_integral<T>::value &&
+				!std::is_same<T, bool>::value && !std::is_same<T, char>::value &&
+				!std::is_same<T, signed char>::value && !std::is_same<T, unsigned char>::value>{});
+		}
+
+		void write_value(const std::string &value)
+		{
+			this->write(value.data(), value.size());
+		}
+
+		void write_value(const char *value)
+		{
+			this->write(value, std::strlen(value));
+		}
+
+		/**
+		 * Hand everything buffered so far to the sink.
+		 */
+		void flush()
+		{
+			if (this->used != 0)
+			{
+				auto size = this->used;
+				this->used = 0;
+				this->output(this->buffer.data(), size);
+			} // else, nothing buffered, do_nothing();
+		}
+
+		Sink &sink()
+		{
+			return this->output;
+		}
+
+	private:
+		// room for the longest 64-bit integer and its sign.
+		static const std::size_t kMinimumCapacity = 32;
+
+		Sink output;
+		std::vector<char> buffer;
+		std::size_t used;
+		std::ostringstream stream;
+
+		/**
+		 * Format an integer straight into the buffer.
+		 */
+		template <typename T>
+		void format(T value, std::true_type)
+		{
+			if (this->buffer.size() - this->used < kMinimumCapacity)
+			{
+				this->flush();
+			} // else, the longest integer still fits, do_nothing();
+
+			auto *first = this->buffer.data() + this->used;
+#if defined(NWACC_HAS_TO_CHARS)
+			auto *last = std::to_chars(first, this->buffer.data() + this->buffer.size(), value).ptr;
+#else
+			// write the digits backwards into a scratch area, then copy.
+			using unsigned_type = typename std::make_unsigned<T>::type;
+			char digits[kMinimumCapacity];
+			auto *digit = digits + kMinimumCapacity;
+			auto magnitude = static_cast<unsigned_type>(value);
+			const bool negative = std::is_signed<T>::value && value < T{ 0 };
+			if (negative)
+			{
+				magnitude = static_cast<unsigned_type>(0 - magnitude);
+			} // else, already positive, do_nothing();
+
+			do
+			{
+				*--digit = static_cast<char>('0' + magnitude % 10);
+				magnitude /= 10;
+			} while (magnitude != 0);
+
+			if (negative)
+			{
+				*--digit = '-';
+			} // else, no sign, do_nothing();
+
+			auto *last = std::copy(digit, digits + kMinimumCapacity, first);
+#endif
+			this->used += static_cast<std::size_t>(last - first);
+		}
+
+		/**
+		 * Format anything else with its operator<<, reusing one stream.
+		 */
+		template <typename T>
+		void format(const T &value, std::false_type)
+		{
+			this->stream.str(std::string());
+			this->stream << value;
+			auto text = this->stream.str();
+			this->write(text.data(), text.size());
+		}
+	};
+
+	/**
+	 * Write every value of [first, last) through the writer, each followed
+	 * by the separator. Passing on from where the last range ended lets a
+	 * huge container be exported a slice at a time.
+	 */
+	template <typename InputIterator, typename Sink>
+	InputIterator write_range(InputIterator first, InputIterator last, buffered_writer<Sink> &writer, char separator = '\n')
+	{
+		for (; first != last; ++first)
+		{
+			writer.write_value(*first);
+			writer.put(separator);
+		}
+		return first;
+	}
+}
+
+#endif // BUFFERED_WRITER_H_
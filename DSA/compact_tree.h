@@ -0,0 +1,623 @@
+#ifndef COMPACT_TREE_H_
+#define COMPACT_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nwacc
+{
+	/**
+	 * An AVL tree laid out to spend as little as possible on anything but
+	 * the values. Nodes live in blocks of a pool owned by the tree and
+	 * link to each other by 32-bit index rather than by pointer, and there
+	 * is no parent link, so a node of ints takes 16 bytes where a tree
+	 * node takes 48. Iterators keep the path down from the root on a stack
+	 * of their own instead.
+	 *
+	 * Removed nodes go on a free list threaded through their left links
+	 * and are handed out again before the pool grows. Blocks are never
+	 * moved, so growing the pool leaves the values where they are. The
+	 * tree holds fewer than 2^32 values.
+	 */
+	template <typename T, typename Compare = std::less<T>>
+	class compact_tree
+	{
+	private:
+		using index_type = std::uint32_t;
+
+		static const index_type kNull = 0xFFFFFFFF;
+		// AVL trees of fewer than 2^32 nodes are at most 46 levels deep.
+		static const int kMaxHeight = 48;
+
+		struct node
+		{
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+			index_type left;
+			index_type right;
+			std::uint8_t height;
+
+			T &element()
+			{
+				return *reinterpret_cast<T *>(&this->storage);
+			}
+		};
+
+	public:
+		/**
+		 * Walks the values in order, keeping the nodes still to come back
+		 * to on a stack. Values cannot be changed through it, as that could
+		 * break the order.
+		 */
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() : tree{ nullptr }, depth{ 0 } {}
+
+			const T &operator*() const
+			{
+				return this->tree->at(this->path[this->depth - 1]).element();
+			}
+
+			const T *operator->() const
+			{
+				return &**this;
+			}
+
+			const_iterator &operator++()
+			{
+				auto right = this->tree->at(this->path[--this->depth]).right;
+				this->push_left_edge(right);
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			bool operator==(const const_iterator &rhs) const
+			{
+				return this->depth == rhs.depth && (this->depth == 0 || this->path[this->depth - 1] == rhs.path[rhs.depth - 1]);
+			}
+
+			bool operator!=(const const_iterator &rhs) const
+			{
+				return !(*this == rhs);
+			}
+
+		private:
+			const compact_tree *tree;
+			index_type path[kMaxHeight];
+			int depth;
+
+			const_iterator(const compact_tree *tree, index_type root) : tree{ tree }, depth{ 0 }
+			{
+				this->push_left_edge(root);
+			}
+
+			// stack current and every left child below it.
+			void push_left_edge(index_type current)
+			{
+				for (; current != kNull; current = this->tree->at(current).left)
+				{
+					this->path[this->depth++] = current;
+				}
+			}
+
+			friend class compact_tree;
+		};
+
+		using iterator = const_iterator;
+
+		explicit compact_tree(const Compare &compare = Compare()) :
+			root{ kNull }, free_list{ kNull }, used{ 0 }, my_size{ 0 }, compare{ compare } {}
+
+		// copy constructor, a bulk load of the values in order.
+		compact_tree(const compact_tree &rhs) : compact_tree{ from_sorted(rhs.begin(), rhs.end(), rhs.compare) } {}
+
+		compact_tree(compact_tree &&rhs) noexcept :
+			blocks{ std::move(rhs.blocks) }, root{ rhs.root }, free_list{ rhs.free_list }, used{ rhs.used },
+			my_size{ rhs.my_size }, compare{ rhs.compare }
+		{
+			rhs.blocks.clear();
+			rhs.root = kNull;
+			rhs.free_list = kNull;
+			rhs.used = 0;
+			rhs.my_size = 0;
+		}
+
+		~compact_tree()
+		{
+			this->clear();
+		}
+
+		compact_tree &operator=(compact_tree rhs)
+		{
+			std::swap(this->blocks, rhs.blocks);
+			std::swap(this->root, rhs.root);
+			std::swap(this->free_list, rhs.free_list);
+			std::swap(this->used, rhs.used);
+			std::swap(this->my_size, rhs.my_size);
+			std::swap(this->compare, rhs.compare);
+			return *this;
+		}
+
+		/**
+		 * Build a height balanced tree from a sorted range in O(n).
+		 * Repeated values are kept once. Nodes are numbered in pre-order,
+		 * so the top of the tree shares the first few cache lines of the
+		 * pool and a step to a left child goes to the next node.
+		 */
+		template <typename ForwardIterator>
+		static compact_tree from_sorted(ForwardIterator first, ForwardIterator last, const Compare &compare = Compare())
+		{
+			compact_tree result{ compare };
+			std::size_t count = 0;
+			for (auto previous = first, next = first; next != last; previous = next++)
+			{
+				if (count == 0 || compare(*previous, *next))
+				{
+					count++;
+				} // else, a repeat, do_nothing();
+			}
+			if (count >= kNull)
+			{
+				throw std::length_error("Too many values for a compact tree");
+			} // else, every node has an index.
+
+			const T *latest = nullptr;
+			result.root = result.build(first, count, latest);
+			result.my_size = count;
+			return result;
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, this->root);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator();
+		}
+
+		std::size_t size() const
+		{
+			return this->my_size;
+		}
+
+		bool is_empty() const
+		{
+			return this->root == kNull;
+		}
+
+		int height() const
+		{
+			return this->height_of(this->root);
+		}
+
+		void clear()
+		{
+			if (!std::is_trivially_destructible<T>::value)
+			{
+				this->destroy_elements(this->root);
+			} // else, the blocks can just go, do_nothing();
+
+			for (auto *block : this->blocks)
+			{
+				delete[] block;
+			}
+			this->blocks.clear();
+			this->root = kNull;
+			this->free_list = kNull;
+			this->used = 0;
+			this->my_size = 0;
+		}
+
+		/**
+		 * Insert a copy of the value. Return an iterator to the value in the
+		 * tree and whether it was inserted; if an equal value was already
+		 * there, nothing changes and the iterator points at that one.
+		 */
+		std::pair<iterator, bool> insert(const T &value)
+		{
+			return this->insert_unique(value);
+		}
+
+		std::pair<iterator, bool> insert(T &&value)
+		{
+			return this->insert_unique(std::move(value));
+		}
+
+		/**
+		 * Remove a value. Return false if it was not present.
+		 */
+		bool remove(const T &value)
+		{
+			auto removed = false;
+			this->root = this->remove(this->root, value, removed);
+			this->my_size -= removed;
+			return removed;
+		}
+
+		const_iterator find(const T &value) const
+		{
+			auto found = this->lower_bound(value);
+			if (found == this->end() || this->compare(value, *found))
+			{
+				return this->end();
+			}
+			return found;
+		}
+
+		/**
+		 * Return the first value not less than value. The nodes passed on
+		 * the left on the way down are the ones the iterator comes back to.
+		 */
+		const_iterator lower_bound(const T &value) const
+		{
+			const_iterator result;
+			result.tree = this;
+			auto current = this->root;
+			while (current != kNull)
+			{
+				auto &here = this->at(current);
+				if (this->compare(here.element(), value))
+				{
+					current = here.right;
+				}
+				else
+				{
+					result.path[result.depth++] = current;
+					if (!this->compare(value, here.element()))
+					{
+						break;
+					} // else, there may be a smaller one on the left.
+
+					current = here.left;
+				}
+			}
+			return result;
+		}
+
+		bool contains(const T &value) const
+		{
+			auto current = this->root;
+			while (current != kNull)
+			{
+				auto &here = this->at(current);
+				if (this->compare(value, here.element()))
+				{
+					current = here.left;
+				}
+				else if (this->compare(here.element(), value))
+				{
+					current = here.right;
+				}
+				else
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		// nodes per block, a power of two.
+		static const int kBlockBits = 12;
+		static const index_type kBlockNodes = index_type{ 1 } << kBlockBits;
+
+		std::vector<node *> blocks;
+		index_type root;
+		index_type free_list;
+		// nodes handed out from the blocks so far, free or not.
+		index_type used;
+		std::size_t my_size;
+		Compare compare;
+
+		node &at(index_type current) const
+		{
+			return this->blocks[current >> kBlockBits][current & (kBlockNodes - 1)];
+		}
+
+		/**
+		 * Take a node from the free list, or the next one from the pool,
+		 * adding a block when the last is used up.
+		 */
+		index_type allocate_node()
+		{
+			if (this->free_list != kNull)
+			{
+				auto current = this->free_list;
+				this->free_list = this->at(current).left;
+				return current;
+			}
+			else if (this->used == kNull)
+			{
+				throw std::length_error("Too many values for a compact tree");
+			}
+			else if ((this->used & (kBlockNodes - 1)) == 0)
+			{
+				this->blocks.push_back(new node[kBlockNodes]);
+			} // else, there is room in the last block.
+
+			return this->used++;
+		}
+
+		void free_node(index_type current)
+		{
+			this->at(current).left = this->free_list;
+			this->free_list = current;
+		}
+
+		template <typename Value>
+		index_type create_node(Value &&value)
+		{
+			auto current = this->allocate_node();
+			auto &fresh = this->at(current);
+			try
+			{
+				::new (static_cast<void *>(&fresh.storage)) T(std::forward<Value>(value));
+			}
+			catch (...)
+			{
+				this->free_node(current);
+				throw;
+			}
+			fresh.left = kNull;
+			fresh.right = kNull;
+			fresh.height = 1;
+			return current;
+		}
+
+		void destroy_node(index_type current)
+		{
+			this->at(current).element().~T();
+			this->free_node(current);
+		}
+
+		void destroy_elements(index_type current)
+		{
+			if (current != kNull)
+			{
+				auto &here = this->at(current);
+				this->destroy_elements(here.left);
+				this->destroy_elements(here.right);
+				here.element().~T();
+			} // else, an empty subtree, do_nothing();
+		}
+
+		/**
+		 * Build a subtree of the next count values, taking a node for the
+		 * root before building the left subtree, and return its root.
+		 * latest is the last value used, to skip repeats of it.
+		 */
+		template <typename ForwardIterator>
+		index_type build(ForwardIterator &next, std::size_t count, const T *&latest)
+		{
+			if (count == 0)
+			{
+				return kNull;
+			} // else, the middle value is the root.
+
+			auto current = this->allocate_node();
+			auto left_count = count / 2;
+			auto left = this->build(next, left_count, latest);
+			index_type right;
+			try
+			{
+				while (latest != nullptr && !this->compare(*latest, *next))
+				{
+					++next;
+				}
+				::new (static_cast<void *>(&this->at(current).storage)) T(*next);
+			}
+			catch (...)
+			{
+				this->destroy_elements(left);
+				throw;
+			}
+			latest = &this->at(current).element();
+			++next;
+
+			try
+			{
+				right = this->build(next, count - left_count - 1, latest);
+			}
+			catch (...)
+			{
+				this->destroy_elements(left);
+				this->at(current).element().~T();
+				throw;
+			}
+			auto &here = this->at(current);
+			here.left = left;
+			here.right = right;
+			this->update(current);
+			return current;
+		}
+
+		int height_of(index_type current) const
+		{
+			return current == kNull ? 0 : this->at(current).height;
+		}
+
+		void update(index_type current)
+		{
+			auto &here = this->at(current);
+			here.height = static_cast<std::uint8_t>(1 + std::max(this->height_of(here.left), this->height_of(here.right)));
+		}
+
+		index_type rotate_left(index_type current)
+		{
+			auto right = this->at(current).right;
+			this->at(current).right = this->at(right).left;
+			this->at(right).left = current;
+			this->update(current);
+			this->update(right);
+			return right;
+		}
+
+		index_type rotate_right(index_type current)
+		{
+			auto left = this->at(current).left;
+			this->at(current).left = this->at(left).right;
+			this->at(left).right = current;
+			this->update(current);
+			this->update(left);
+			return left;
+		}
+
+		/**
+		 * Restore the AVL balance at a node whose subtrees differ in height
+		 * by at most two, returning the root of the subtree.
+		 */
+		index_type balance(index_type current)
+		{
+			this->update(current);
+			auto &here = this->at(current);
+			auto difference = this->height_of(here.left) - this->height_of(here.right);
+			if (difference > 1)
+			{
+				auto &left = this->at(here.left);
+				if (this->height_of(left.left) < this->height_of(left.right))
+				{
+					here.left = this->rotate_left(here.left);
+				} // else, a single rotation will do.
+
+				return this->rotate_right(current);
+			}
+			else if (difference < -1)
+			{
+				auto &right = this->at(here.right);
+				if (this->height_of(right.right) < this->height_of(right.left))
+				{
+					here.right = this->rotate_right(here.right);
+				} // else, a single rotation will do.
+
+				return this->rotate_left(current);
+			} // else, balanced, do_nothing();
+
+			return current;
+		}
+
+		/**
+		 * Insert, then find the value again for the iterator, as the
+		 * rotations on the way back up change the path to it.
+		 */
+		template <typename Value>
+		std::pair<iterator, bool> insert_unique(Value &&value)
+		{
+			auto inserted = false;
+			index_type where;
+			this->root = this->insert(this->root, std::forward<Value>(value), inserted, where);
+			this->my_size += inserted;
+			return { this->lower_bound(this->at(where).element()), inserted };
+		}
+
+		/**
+		 * Insert into the subtree and return its new root, leaving the node
+		 * that holds the value in where. Nodes are looked up again after
+		 * the recursive call, as a new block may have been added.
+		 */
+		template <typename Value>
+		index_type insert(index_type current, Value &&value, bool &inserted, index_type &where)
+		{
+			if (current == kNull)
+			{
+				inserted = true;
+				where = this->create_node(std::forward<Value>(value));
+				return where;
+			}
+			else if (this->compare(value, this->at(current).element()))
+			{
+				auto left = this->insert(this->at(current).left, std::forward<Value>(value), inserted, where);
+				this->at(current).left = left;
+			}
+			else if (this->compare(this->at(current).element(), value))
+			{
+				auto right = this->insert(this->at(current).right, std::forward<Value>(value), inserted, where);
+				this->at(current).right = right;
+			}
+			else
+			{
+				where = current;
+				return current;
+			}
+			return inserted ? this->balance(current) : current;
+		}
+
+		/**
+		 * Remove from the subtree and return its new root. A node with two
+		 * children is replaced by the smallest node of its right subtree,
+		 * relinked rather than copied.
+		 */
+		index_type remove(index_type current, const T &value, bool &removed)
+		{
+			if (current == kNull)
+			{
+				return kNull;
+			}
+
+			auto &here = this->at(current);
+			if (this->compare(value, here.element()))
+			{
+				here.left = this->remove(here.left, value, removed);
+			}
+			else if (this->compare(here.element(), value))
+			{
+				here.right = this->remove(here.right, value, removed);
+			}
+			else
+			{
+				removed = true;
+				if (here.left == kNull || here.right == kNull)
+				{
+					auto child = here.left != kNull ? here.left : here.right;
+					this->destroy_node(current);
+					return child;
+				} // else, two children.
+
+				index_type successor;
+				auto right = this->remove_minimum(here.right, successor);
+				auto &replacement = this->at(successor);
+				replacement.left = here.left;
+				replacement.right = right;
+				this->destroy_node(current);
+				return this->balance(successor);
+			}
+			return removed ? this->balance(current) : current;
+		}
+
+		// unlink the smallest node of the subtree, returning the new root.
+		index_type remove_minimum(index_type current, index_type &minimum)
+		{
+			auto &here = this->at(current);
+			if (here.left == kNull)
+			{
+				minimum = current;
+				return here.right;
+			} // else, it is further left.
+
+			here.left = this->remove_minimum(here.left, minimum);
+			return this->balance(current);
+		}
+	};
+}
+
+#endif // COMPACT_TREE_H_
@@ -0,0 +1,242 @@
+#ifndef CONCURRENT_ARRAY_LIST_H_
+#define CONCURRENT_ARRAY_LIST_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace nwacc
+{
+	/**
+	 * An array list that many threads may append to at once without
+	 * locking. The elements live in buckets that double in size, bucket 0
+	 * holding the first kFirstBucket elements, bucket 1 the next
+	 * 2 * kFirstBucket and so on, so growing only ever adds a bucket and
+	 * never moves an element. References and indices stay valid for the
+	 * life of the list, and readers may index while writers append.
+	 *
+	 * push_back makes sure the bucket for the next index exists, then
+	 * claims that index with a compare and swap on the size and moves the
+	 * value, built beforehand, into place. If another thread claimed it
+	 * first it tries again at the new size. The first thread to need a
+	 * bucket allocates it and publishes it with a compare and swap, and any
+	 * thread that lost the race frees its copy. Nothing that can throw
+	 * happens after an index is claimed, so a throwing constructor or
+	 * allocator never leaves a hole.
+	 *
+	 * size counts every claimed index, including ones still being filled
+	 * in, so a reader may only look at an index that push_back returned to
+	 * a thread it has synchronized with, or at anything once the writers
+	 * are done. The Allocator is called from whichever thread needs a new
+	 * bucket, so it has to be safe to share between threads.
+	 */
+	template <typename T, typename Allocator = std::allocator<T>>
+	class concurrent_array_list
+	{
+	public:
+		// log2 of the elements in the first bucket.
+		static const int kFirstBucketBits = 5;
+		static const std::size_t kFirstBucket = std::size_t{ 1 } << kFirstBucketBits;
+
+		explicit concurrent_array_list(const Allocator &allocator = Allocator{}) : my_size{ 0 }, allocator{ allocator }
+		{
+			static_assert(std::is_nothrow_move_constructible<T>::value, "values are moved into place after their index is claimed");
+			for (auto &bucket : this->buckets)
+			{
+				bucket.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+
+		concurrent_array_list(const concurrent_array_list &rhs) = delete;
+		concurrent_array_list &operator=(const concurrent_array_list &rhs) = delete;
+
+		~concurrent_array_list()
+		{
+			auto size = this->my_size.load(std::memory_order_relaxed);
+			for (std::size_t index = 0; index < size; index++)
+			{
+				(*this)[index].~T();
+			}
+			for (auto bucket = 0; bucket < kBuckets; bucket++)
+			{
+				auto *elements = this->buckets[bucket].load(std::memory_order_relaxed);
+				if (elements != nullptr)
+				{
+					allocator_traits::deallocate(this->allocator, elements, bucket_size(bucket));
+				} // else, never needed, do_nothing();
+			}
+		}
+
+		/**
+		 * Append a value and return its index.
+		 */
+		std::size_t push_back(const T &value)
+		{
+			return this->emplace_back(value);
+		}
+
+		std::size_t push_back(T &&value)
+		{
+			return this->emplace_back(std::move(value));
+		}
+
+		template <typename... Args>
+		std::size_t emplace_back(Args &&... args)
+		{
+			T value(std::forward<Args>(args)...);
+			auto index = this->my_size.load(std::memory_order_relaxed);
+			while (true)
+			{
+				auto bucket = bucket_of(index);
+				auto *elements = this->ensure_bucket(bucket);
+				if (this->my_size.compare_exchange_weak(index, index + 1, std::memory_order_relaxed, std::memory_order_relaxed))
+				{
+					::new (static_cast<void *>(elements + offset_in(bucket, index))) T(std::move(value));
+					return index;
+				} // else, index now holds the new size, try there.
+			}
+		}
+
+		/**
+		 * Allocate the buckets for the first capacity elements now, so the
+		 * appends that fill them never stop to allocate.
+		 */
+		void reserve(std::size_t capacity)
+		{
+			if (capacity != 0)
+			{
+				auto last = bucket_of(capacity - 1);
+				for (auto bucket = 0; bucket <= last; bucket++)
+				{
+					this->ensure_bucket(bucket);
+				}
+			} // else, nothing to reserve, do_nothing();
+		}
+
+		T &operator[](std::size_t index)
+		{
+			return *this->slot(index);
+		}
+
+		const T &operator[](std::size_t index) const
+		{
+			return *const_cast<concurrent_array_list *>(this)->slot(index);
+		}
+
+		/**
+		 * Return the element at index, or throw std::out_of_range if no
+		 * append has claimed it.
+		 */
+		T &at(std::size_t index)
+		{
+			this->check_index(index);
+			return (*this)[index];
+		}
+
+		const T &at(std::size_t index) const
+		{
+			this->check_index(index);
+			return (*this)[index];
+		}
+
+		std::size_t size() const
+		{
+			return this->my_size.load(std::memory_order_acquire);
+		}
+
+		bool is_empty() const
+		{
+			return this->size() == 0;
+		}
+
+	private:
+		using allocator_traits = std::allocator_traits<Allocator>;
+
+		static const int kBuckets = static_cast<int>(8 * sizeof(std::size_t)) - kFirstBucketBits;
+
+		std::atomic<std::size_t> my_size;
+		std::atomic<T *> buckets[kBuckets];
+		Allocator allocator;
+
+		/**
+		 * Return the position of the highest set bit of value, which is not
+		 * zero.
+		 */
+		static int highest_bit(std::size_t value)
+		{
+#if defined(_MSC_VER) && defined(_WIN64)
+			unsigned long index;
+			_BitScanReverse64(&index, value);
+			return static_cast<int>(index);
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanReverse(&index, static_cast<unsigned long>(value));
+			return static_cast<int>(index);
+#else
+			return 63 - __builtin_clzll(static_cast<unsigned long long>(value));
+#endif
+		}
+
+		static std::size_t bucket_size(int bucket)
+		{
+			return kFirstBucket << bucket;
+		}
+
+		// bucket b starts at index kFirstBucket * (2^b - 1).
+		static int bucket_of(std::size_t index)
+		{
+			return highest_bit(index + kFirstBucket) - kFirstBucketBits;
+		}
+
+		// where the element at index lives, in a bucket that exists.
+		T *slot(std::size_t index)
+		{
+			auto bucket = bucket_of(index);
+			return this->buckets[bucket].load(std::memory_order_acquire) + offset_in(bucket, index);
+		}
+
+		static std::size_t offset_in(int bucket, std::size_t index)
+		{
+			return index + kFirstBucket - bucket_size(bucket);
+		}
+
+		/**
+		 * Return the bucket, allocating and publishing it if no other
+		 * thread has yet.
+		 */
+		T *ensure_bucket(int bucket)
+		{
+			auto *elements = this->buckets[bucket].load(std::memory_order_acquire);
+			if (elements != nullptr)
+			{
+				return elements;
+			} // else, it has to be allocated.
+
+			auto *fresh = allocator_traits::allocate(this->allocator, bucket_size(bucket));
+			if (this->buckets[bucket].compare_exchange_strong(elements, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				return fresh;
+			} // else, another thread got there first, use theirs.
+
+			allocator_traits::deallocate(this->allocator, fresh, bucket_size(bucket));
+			return elements;
+		}
+
+		void check_index(std::size_t index) const
+		{
+			if (index >= this->size())
+			{
+				throw std::out_of_range("Index out of range in concurrent array list");
+			} // else, the index has been claimed, do_nothing();
+		}
+	};
+}
+
+#endif // CONCURRENT_ARRAY_LIST_H_
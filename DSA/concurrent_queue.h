@@ -0,0 +1,298 @@
+#ifndef CONCURRENT_QUEUE_H_
+#define CONCURRENT_QUEUE_H_
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+
+#include "epoch.h"
+
+namespace nwacc
+{
+	/**
+	 * A node for the concurrent lists: a value and a link, as in
+	 * linked_list, but with the value constructed only while the node is
+	 * holding one, so a queue's first dummy node needs no T at all. A
+	 * node still holding a value destroys it when it is deleted.
+	 */
+	template <typename T>
+	struct concurrent_node
+	{
+		typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		std::atomic<concurrent_node *> next;
+		bool holds_value;
+
+		concurrent_node() : next{ nullptr }, holds_value{ false } {}
+
+		concurrent_node(const concurrent_node &rhs) = delete;
+		concurrent_node &operator=(const concurrent_node &rhs) = delete;
+
+		~concurrent_node()
+		{
+			if (this->holds_value)
+			{
+				this->data().~T();
+			} // else, empty, do_nothing();
+		}
+
+		T &data()
+		{
+			return *reinterpret_cast<T *>(&this->storage);
+		}
+	};
+
+	/**
+	 * A first in, first out queue that many threads may push to and pop
+	 * from at once without locking (a Michael-Scott queue). push_back links
+	 * a new node after the tail with a compare and swap, and pop_front
+	 * swings the head on to the next node, whose value it copies out. That
+	 * node becomes the dummy and keeps its value until the next pop
+	 * unlinks it and the epoch domain reclaims it, so front may copy the
+	 * value while other threads pop it. Values are copied rather than
+	 * moved for the same reason.
+	 *
+	 * Popping from an empty queue returns false rather than waiting.
+	 * There is no size, which would put every thread on one counter.
+	 */
+	template <typename T>
+	class concurrent_queue
+	{
+	private:
+		using node = concurrent_node<T>;
+	public:
+		concurrent_queue()
+		{
+			auto *dummy = new node();
+			this->head.store(dummy, std::memory_order_relaxed);
+			this->tail.store(dummy, std::memory_order_relaxed);
+		}
+
+		concurrent_queue(const concurrent_queue &rhs) = delete;
+		concurrent_queue &operator=(const concurrent_queue &rhs) = delete;
+
+		~concurrent_queue()
+		{
+			auto *current = this->head.load(std::memory_order_relaxed);
+			while (current != nullptr)
+			{
+				auto *next = current->next.load(std::memory_order_relaxed);
+				delete current;
+				current = next;
+			}
+		}
+
+		void push_back(const T &value)
+		{
+			this->emplace_back(value);
+		}
+
+		void push_back(T &&value)
+		{
+			this->emplace_back(std::move(value));
+		}
+
+		template <typename... Args>
+		void emplace_back(Args &&... args)
+		{
+			auto *fresh = new node();
+			try
+			{
+				::new (static_cast<void *>(&fresh->storage)) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				delete fresh;
+				throw;
+			}
+			fresh->holds_value = true;
+
+			auto pinned = this->domain.pin();
+			while (true)
+			{
+				auto *last = this->tail.load(std::memory_order_acquire);
+				auto *next = last->next.load(std::memory_order_acquire);
+				if (next != nullptr)
+				{
+					// the tail is behind, help it along and try again.
+					this->tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+					continue;
+				} // else, last really is the last node.
+
+				if (last->next.compare_exchange_weak(next, fresh, std::memory_order_release, std::memory_order_relaxed))
+				{
+					this->tail.compare_exchange_strong(last, fresh, std::memory_order_release, std::memory_order_relaxed);
+					return;
+				} // else, another thread linked a node first, try again.
+			}
+		}
+
+		/**
+		 * Copy the value at the front into value and remove it. Return
+		 * false, leaving value alone, if the queue is empty. The copy is
+		 * taken before the value is unlinked, so a throwing copy leaves the
+		 * queue as it was.
+		 */
+		bool pop_front(T &value)
+		{
+			auto pinned = this->domain.pin();
+			while (true)
+			{
+				auto *first = this->head.load(std::memory_order_acquire);
+				auto *next = first->next.load(std::memory_order_acquire);
+				if (next == nullptr)
+				{
+					return false;
+				} // else, there is a value to take.
+
+				auto *last = this->tail.load(std::memory_order_acquire);
+				if (first == last)
+				{
+					// the tail is behind, help it along before unlinking.
+					this->tail.compare_exchange_weak(last, next, std::memory_order_release, std::memory_order_relaxed);
+				} // else, the tail is past the head, do_nothing();
+
+				// next keeps its value until it is reclaimed, so this is safe
+				// even if another thread pops it first.
+				T copy(next->data());
+				if (this->head.compare_exchange_weak(first, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+				{
+					// next is the dummy now, and first, with the value popped
+					// before it, is reclaimed once no thread can be reading it.
+					value = std::move(copy);
+					this->domain.retire(pinned, first);
+					return true;
+				} // else, another thread took it first, try again.
+			}
+		}
+
+		/**
+		 * Copy the value at the front into value without removing it.
+		 * Return false if the queue is empty. Another thread may pop it
+		 * before the copy is used, but the node stays alive while pinned.
+		 */
+		bool front(T &value) const
+		{
+			auto pinned = this->domain.pin();
+			auto *next = this->head.load(std::memory_order_acquire)->next.load(std::memory_order_acquire);
+			if (next == nullptr)
+			{
+				return false;
+			} // else, there is a value to look at.
+
+			value = next->data();
+			return true;
+		}
+
+		bool is_empty() const
+		{
+			auto pinned = this->domain.pin();
+			return this->head.load(std::memory_order_acquire)->next.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		// the head and the tail are written by different threads, so each
+		// gets a cache line of its own.
+		alignas(64) std::atomic<node *> head;
+		alignas(64) std::atomic<node *> tail;
+		mutable epoch_domain domain;
+	};
+
+	/**
+	 * A last in, first out stack that many threads may push to and pop
+	 * from at once without locking (a Treiber stack), with the same
+	 * vocabulary as the queue. A popped node is retired through the epoch
+	 * domain, so it cannot be reused while another thread might still be
+	 * comparing against it.
+	 */
+	template <typename T>
+	class concurrent_stack
+	{
+	private:
+		using node = concurrent_node<T>;
+	public:
+		concurrent_stack() : top{ nullptr } {}
+
+		concurrent_stack(const concurrent_stack &rhs) = delete;
+		concurrent_stack &operator=(const concurrent_stack &rhs) = delete;
+
+		~concurrent_stack()
+		{
+			auto *current = this->top.load(std::memory_order_relaxed);
+			while (current != nullptr)
+			{
+				auto *next = current->next.load(std::memory_order_relaxed);
+				delete current;
+				current = next;
+			}
+		}
+
+		void push_front(const T &value)
+		{
+			this->emplace_front(value);
+		}
+
+		void push_front(T &&value)
+		{
+			this->emplace_front(std::move(value));
+		}
+
+		template <typename... Args>
+		void emplace_front(Args &&... args)
+		{
+			auto *fresh = new node();
+			try
+			{
+				::new (static_cast<void *>(&fresh->storage)) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				delete fresh;
+				throw;
+			}
+			fresh->holds_value = true;
+
+			auto *first = this->top.load(std::memory_order_relaxed);
+			do
+			{
+				fresh->next.store(first, std::memory_order_relaxed);
+			} while (!this->top.compare_exchange_weak(first, fresh, std::memory_order_release, std::memory_order_relaxed));
+		}
+
+		/**
+		 * Move the value on top into value and remove it. Return false,
+		 * leaving value alone, if the stack is empty.
+		 */
+		bool pop_front(T &value)
+		{
+			auto pinned = this->domain.pin();
+			auto *first = this->top.load(std::memory_order_acquire);
+			while (first != nullptr &&
+				!this->top.compare_exchange_weak(first, first->next.load(std::memory_order_relaxed), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				// first was reloaded by the failed swap, try again.
+			}
+
+			if (first == nullptr)
+			{
+				return false;
+			} // else, the node is ours alone.
+
+			value = std::move(first->data());
+			first->data().~T();
+			first->holds_value = false;
+			this->domain.retire(pinned, first);
+			return true;
+		}
+
+		bool is_empty() const
+		{
+			return this->top.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		std::atomic<node *> top;
+		epoch_domain domain;
+	};
+}
+
+#endif // CONCURRENT_QUEUE_H_
@@ -0,0 +1,853 @@
+#ifndef CONCURRENT_TREE_H_
+#define CONCURRENT_TREE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+#include "epoch.h"
+
+namespace nwacc
+{
+	/**
+	 * A balanced (AVL) search tree that many threads may use at once, after
+	 * Bronson, Casper, Chafi and Olukotun's optimistic concurrent AVL tree.
+	 *
+	 * Writers lock only the nodes they change: an insert locks the node it
+	 * hangs the new leaf from, a remove the node and its parent, and the
+	 * rebalancing that follows each locks a parent and the two or three
+	 * nodes it rotates, always top down. Writers to different parts of the
+	 * tree do not wait on each other. A removed value whose node still has
+	 * two children just leaves the node behind, marked absent, to route
+	 * searches until rebalancing can unlink it.
+	 *
+	 * contains takes no locks. Every node carries a version that a rotation
+	 * moving it down changes, and a search checks the version of each node
+	 * it leaves after reading the next link, so it never follows a node out
+	 * of the range it was searching. If a check fails it backs up one level
+	 * and tries again, and if it meets a rotation under way it waits for
+	 * that one node. Unlinked nodes are reclaimed through the epoch domain.
+	 *
+	 * Balance is relaxed while writers race, and restored once they stop.
+	 */
+	template <typename T>
+	class concurrent_tree
+	{
+	private:
+		/**
+		 * A lock small enough for every node to have one, held only for a
+		 * handful of stores.
+		 */
+		class spin_lock
+		{
+		public:
+			spin_lock() : locked{ false } {}
+
+			void lock()
+			{
+				while (this->locked.exchange(true, std::memory_order_acquire))
+				{
+					while (this->locked.load(std::memory_order_relaxed))
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+
+			void unlock()
+			{
+				this->locked.store(false, std::memory_order_release);
+			}
+
+		private:
+			std::atomic<bool> locked;
+		};
+
+		struct node
+		{
+			// kUnlinked once out of the tree, or a count of the rotations
+			// that moved this node down, with kShrinking set during one.
+			std::atomic<std::uint64_t> version;
+			std::atomic<node *> left;
+			std::atomic<node *> right;
+			std::atomic<node *> parent;
+			std::atomic<int> height;
+			// false for a node left behind to route searches.
+			std::atomic<bool> present;
+			spin_lock lock;
+			bool holds_element;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+			// the holder above the root, which has no element.
+			node() : version{ 0 }, left{ nullptr }, right{ nullptr }, parent{ nullptr }, height{ 0 }, present{ false }, holds_element{ false } {}
+
+			node(const T &the_element, node *parent_node) :
+				version{ 0 }, left{ nullptr }, right{ nullptr }, parent{ parent_node }, height{ 1 }, present{ true }, holds_element{ false }
+			{
+				::new (static_cast<void *>(&this->storage)) T(the_element);
+				this->holds_element = true;
+			}
+
+			node(const node &rhs) = delete;
+			node &operator=(const node &rhs) = delete;
+
+			~node()
+			{
+				if (this->holds_element)
+				{
+					this->element().~T();
+				} // else, the holder, do_nothing();
+			}
+
+			const T &element() const
+			{
+				return *reinterpret_cast<const T *>(&this->storage);
+			}
+
+			std::atomic<node *> &child(int direction)
+			{
+				return direction < 0 ? this->left : this->right;
+			}
+		};
+
+		/**
+		 * The nodes a rebalancing walk still has to look at, deepest on top.
+		 * A rotation can leave its parent and the nodes it moved needing a
+		 * look. Heights only steer balance, so nodes past the capacity are
+		 * left for later walks rather than allocating.
+		 */
+		class repair_list
+		{
+		public:
+			repair_list() : count{ 0 } {}
+
+			void push(node *current)
+			{
+				if (this->count < kCapacity)
+				{
+					this->nodes[this->count++] = current;
+				} // else, full, do_nothing();
+			}
+
+			node *pop()
+			{
+				return this->count == 0 ? nullptr : this->nodes[--this->count];
+			}
+
+		private:
+			static const int kCapacity = 64;
+			node *nodes[kCapacity];
+			int count;
+		};
+
+	public:
+		concurrent_tree() : my_size{ 0 } {}
+
+		concurrent_tree(const concurrent_tree &rhs) = delete;
+		concurrent_tree &operator=(const concurrent_tree &rhs) = delete;
+
+		~concurrent_tree()
+		{
+			this->empty(this->holder.right.load(std::memory_order_relaxed));
+		}
+
+		/**
+		 * Insert a value. Return false if it was already present.
+		 */
+		bool insert(const T &value)
+		{
+			auto pinned = this->domain.pin();
+			insertion operation{ this, value, pinned };
+			auto inserted = this->attempt(value, &this->holder, 1, 0, operation) == result::yes;
+			if (inserted)
+			{
+				this->my_size.fetch_add(1, std::memory_order_relaxed);
+			} // else, nothing changed, do_nothing();
+			return inserted;
+		}
+
+		/**
+		 * Remove a value. Return false if it was not present.
+		 */
+		bool remove(const T &value)
+		{
+			auto pinned = this->domain.pin();
+			removal operation{ this, pinned };
+			auto removed = this->attempt(value, &this->holder, 1, 0, operation) == result::yes;
+			if (removed)
+			{
+				this->my_size.fetch_sub(1, std::memory_order_relaxed);
+			} // else, nothing changed, do_nothing();
+			return removed;
+		}
+
+		/**
+		 * Determine if the value is contained within the tree. Takes no
+		 * locks, though it may wait for a rotation of a node on its path to
+		 * finish.
+		 */
+		bool contains(const T &value) const
+		{
+			auto pinned = this->domain.pin();
+			lookup operation;
+			return const_cast<concurrent_tree *>(this)->attempt(value, &this->holder, 1, 0, operation) == result::yes;
+		}
+
+		/**
+		 * Return the number of values. Under concurrent updates this may
+		 * briefly lag behind the tree.
+		 */
+		std::size_t size() const
+		{
+			return this->my_size.load(std::memory_order_relaxed);
+		}
+
+		bool is_empty() const
+		{
+			return this->size() == 0;
+		}
+
+	private:
+		static const std::uint64_t kUnlinked = 1;
+		static const std::uint64_t kShrinking = 4;
+		static const std::uint64_t kShrinkCountIncrement = 8;
+
+		// what node_condition returns when not a new height.
+		static const int kUnlinkRequired = -1;
+		static const int kRebalanceRequired = -2;
+		static const int kNothingRequired = -3;
+
+		enum class result
+		{
+			retry,
+			yes,
+			no
+		};
+
+		// the root is the right child of the holder, which never moves.
+		mutable node holder;
+		std::atomic<std::size_t> my_size;
+		mutable epoch_domain domain;
+
+		static int compare(const T &lhs, const T &rhs)
+		{
+			return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0);
+		}
+
+		static int height_of(const node *current)
+		{
+			return current == nullptr ? 0 : current->height.load();
+		}
+
+		static bool can_unlink(const node *current)
+		{
+			return current->left.load() == nullptr || current->right.load() == nullptr;
+		}
+
+		/**
+		 * Wait for the rotation moving current down to finish. It holds
+		 * current's lock for the whole rotation.
+		 */
+		static void wait_until_not_changing(node *current)
+		{
+			if ((current->version.load() & kShrinking) != 0)
+			{
+				std::lock_guard<spin_lock> lock{ current->lock };
+			} // else, already done, do_nothing();
+		}
+
+		struct lookup
+		{
+			result found(node *, node *child)
+			{
+				return child->present.load() ? result::yes : result::no;
+			}
+
+			result missing(node *, int, std::uint64_t)
+			{
+				return result::no;
+			}
+		};
+
+		struct insertion
+		{
+			concurrent_tree *tree;
+			const T &value;
+			const epoch_domain::guard &pinned;
+
+			result found(node *, node *child)
+			{
+				return tree->attempt_update(child);
+			}
+
+			result missing(node *parent, int direction, std::uint64_t version)
+			{
+				return tree->attempt_insert(this->value, parent, direction, version, this->pinned);
+			}
+		};
+
+		struct removal
+		{
+			concurrent_tree *tree;
+			const epoch_domain::guard &pinned;
+
+			result found(node *parent, node *child)
+			{
+				return tree->attempt_remove_node(parent, child, this->pinned);
+			}
+
+			result missing(node *, int, std::uint64_t)
+			{
+				return result::no;
+			}
+		};
+
+		/**
+		 * Search for value below current, which had the given version when
+		 * the search reached it along direction, and hand the node holding
+		 * value, or the empty link where it belongs, to operation. Return
+		 * retry if current has since been moved, so the caller looks again
+		 * from one level up.
+		 */
+		template <typename Operation>
+		result attempt(const T &value, node *current, int direction, std::uint64_t version, Operation &operation)
+		{
+			while (true)
+			{
+				auto *child = current->child(direction).load();
+				if (current->version.load() != version)
+				{
+					return result::retry;
+				} // else, child was current's child while current was in range.
+
+				auto outcome = result::retry;
+				if (child == nullptr)
+				{
+					outcome = operation.missing(current, direction, version);
+				}
+				else
+				{
+					auto next = compare(value, child->element());
+					if (next == 0)
+					{
+						outcome = operation.found(current, child);
+					}
+					else
+					{
+						auto child_version = child->version.load();
+						if ((child_version & kShrinking) != 0)
+						{
+							wait_until_not_changing(child);
+						}
+						else if (child_version != kUnlinked && child == current->child(direction).load())
+						{
+							if (current->version.load() != version)
+							{
+								return result::retry;
+							} // else, still in range, go down.
+
+							outcome = this->attempt(value, child, next, child_version, operation);
+						} // else, the child was replaced, look again.
+					}
+				}
+
+				if (outcome != result::retry)
+				{
+					return outcome;
+				} // else, try again from here.
+			}
+		}
+
+		result attempt_insert(const T &value, node *parent, int direction, std::uint64_t version, const epoch_domain::guard &pinned)
+		{
+			{
+				std::lock_guard<spin_lock> lock{ parent->lock };
+				if (parent->version.load() != version || parent->child(direction).load() != nullptr)
+				{
+					return result::retry;
+				} // else, the link is still empty and in range.
+
+				parent->child(direction).store(new node(value, parent));
+			}
+			this->fix_height_and_rebalance(parent, pinned);
+			return result::yes;
+		}
+
+		// mark a node that routes searches for value as holding it again.
+		result attempt_update(node *current)
+		{
+			std::lock_guard<spin_lock> lock{ current->lock };
+			if (current->version.load() == kUnlinked)
+			{
+				return result::retry;
+			}
+			else if (current->present.load())
+			{
+				return result::no;
+			} // else, bring it back.
+
+			current->present.store(true);
+			return result::yes;
+		}
+
+		/**
+		 * Remove the value held by current, unlinking current if it has a
+		 * child to spare and otherwise leaving it to route searches.
+		 */
+		result attempt_remove_node(node *parent, node *current, const epoch_domain::guard &pinned)
+		{
+			if (!current->present.load())
+			{
+				return result::no;
+			}
+			else if (!can_unlink(current))
+			{
+				std::lock_guard<spin_lock> lock{ current->lock };
+				if (current->version.load() == kUnlinked || can_unlink(current))
+				{
+					return result::retry;
+				}
+				else if (!current->present.load())
+				{
+					return result::no;
+				} // else, two children, so it stays to route.
+
+				current->present.store(false);
+				return result::yes;
+			} // else, it can come out of the tree.
+
+			{
+				std::lock_guard<spin_lock> parent_lock{ parent->lock };
+				if (parent->version.load() == kUnlinked || current->parent.load() != parent || current->version.load() == kUnlinked)
+				{
+					return result::retry;
+				} // else, parent still holds current.
+
+				std::lock_guard<spin_lock> lock{ current->lock };
+				if (!current->present.load())
+				{
+					return result::no;
+				}
+				else if (!can_unlink(current))
+				{
+					return result::retry;
+				} // else, splice it out.
+
+				auto *left = current->left.load();
+				auto *splice = left != nullptr ? left : current->right.load();
+				parent->child(parent->left.load() == current ? -1 : 1).store(splice);
+				if (splice != nullptr)
+				{
+					splice->parent.store(parent);
+				} // else, current was a leaf, do_nothing();
+				current->version.store(kUnlinked);
+				current->present.store(false);
+			}
+			this->domain.retire(pinned, current);
+			this->fix_height_and_rebalance(parent, pinned);
+			return result::yes;
+		}
+
+		/**
+		 * Return what current needs: kUnlinkRequired for a routing node
+		 * with a child to spare, kRebalanceRequired if its subtrees differ
+		 * in height by more than one, its correct height if the one it has
+		 * is wrong, or else kNothingRequired.
+		 */
+		static int node_condition(node *current)
+		{
+			auto *left = current->left.load();
+			auto *right = current->right.load();
+			if ((left == nullptr || right == nullptr) && !current->present.load())
+			{
+				return kUnlinkRequired;
+			} // else, it stays.
+
+			auto left_height = height_of(left);
+			auto right_height = height_of(right);
+			auto replacement = 1 + std::max(left_height, right_height);
+			auto balance = left_height - right_height;
+			if (balance < -1 || balance > 1)
+			{
+				return kRebalanceRequired;
+			} // else, at most the height is off.
+
+			return current->height.load() != replacement ? replacement : kNothingRequired;
+		}
+
+		/**
+		 * Walk up from start repairing heights, balance and routing nodes
+		 * until a node needs nothing, then do the same from each node a
+		 * rotation on the way left to look at. Each node, or parent and
+		 * node, is locked only while it is fixed.
+		 */
+		void fix_height_and_rebalance(node *start, const epoch_domain::guard &pinned)
+		{
+			repair_list work;
+			work.push(start);
+			for (auto *current = work.pop(); current != nullptr; current = work.pop())
+			{
+				while (current != nullptr && current->parent.load() != nullptr)
+				{
+					auto condition = node_condition(current);
+					if (condition == kNothingRequired || current->version.load() == kUnlinked)
+					{
+						break;
+					}
+					else if (condition != kUnlinkRequired && condition != kRebalanceRequired)
+					{
+						std::lock_guard<spin_lock> lock{ current->lock };
+						current = fix_height(current);
+					}
+					else
+					{
+						auto *parent = current->parent.load();
+						std::lock_guard<spin_lock> parent_lock{ parent->lock };
+						if (parent->version.load() != kUnlinked && current->parent.load() == parent)
+						{
+							std::lock_guard<spin_lock> lock{ current->lock };
+							current = this->rebalance(parent, current, work, pinned);
+						} // else, current moved before we got the lock, look again.
+					}
+				}
+			}
+		}
+
+		/**
+		 * Set the height of a locked node, returning the next node to look
+		 * at: its parent after a change, itself if it needs more than a new
+		 * height, or nullptr if it was right.
+		 */
+		static node *fix_height(node *current)
+		{
+			auto condition = node_condition(current);
+			switch (condition)
+			{
+			case kRebalanceRequired:
+			case kUnlinkRequired:
+				return current;
+			case kNothingRequired:
+				return nullptr;
+			default:
+				current->height.store(condition);
+				return current->parent.load();
+			}
+		}
+
+		/**
+		 * Fix a locked node under its locked parent, returning the next node
+		 * to look at as fix_height does.
+		 */
+		node *rebalance(node *parent, node *current, repair_list &work, const epoch_domain::guard &pinned)
+		{
+			auto *left = current->left.load();
+			auto *right = current->right.load();
+			if ((left == nullptr || right == nullptr) && !current->present.load())
+			{
+				if (attempt_unlink(parent, current))
+				{
+					this->domain.retire(pinned, current);
+					return fix_height(parent);
+				} // else, it has gained a child back, look again.
+
+				return current;
+			} // else, it stays in the tree.
+
+			auto height = current->height.load();
+			auto left_height = height_of(left);
+			auto right_height = height_of(right);
+			auto replacement = 1 + std::max(left_height, right_height);
+			auto balance = left_height - right_height;
+			if (balance > 1)
+			{
+				return rebalance_to_right(parent, current, left, right_height, work);
+			}
+			else if (balance < -1)
+			{
+				return rebalance_to_left(parent, current, right, left_height, work);
+			}
+			else if (replacement != height)
+			{
+				current->height.store(replacement);
+				return fix_height(parent);
+			} // else, nothing to do.
+
+			return nullptr;
+		}
+
+		// splice out a locked routing node with a child to spare.
+		static bool attempt_unlink(node *parent, node *current)
+		{
+			auto *parent_left = parent->left.load();
+			if (parent_left != current && parent->right.load() != current)
+			{
+				return false;
+			} // else, it is still parent's child.
+
+			auto *left = current->left.load();
+			auto *right = current->right.load();
+			if (left != nullptr && right != nullptr)
+			{
+				return false;
+			} // else, one child or none to take its place.
+
+			auto *splice = left != nullptr ? left : right;
+			(parent_left == current ? parent->left : parent->right).store(splice);
+			if (splice != nullptr)
+			{
+				splice->parent.store(parent);
+			} // else, current was a leaf, do_nothing();
+			current->version.store(kUnlinked);
+			current->present.store(false);
+			return true;
+		}
+
+		/**
+		 * Rotate a locked node that is too tall on the left down to the
+		 * right, doubly if its left child is taller on the inside. Returns
+		 * current to look again if the heights changed under us, or, if the
+		 * left child or its right child is out of shape itself, that node to
+		 * fix first, with current put back on the list.
+		 */
+		static node *rebalance_to_right(node *parent, node *current, node *left, int right_height, repair_list &work)
+		{
+			std::lock_guard<spin_lock> left_lock{ left->lock };
+			auto left_height = left->height.load();
+			if (left_height - right_height <= 1)
+			{
+				return current;
+			} // else, still too tall on the left.
+
+			auto *left_right = left->right.load();
+			auto left_left_height = height_of(left->left.load());
+			auto left_right_height = height_of(left_right);
+			if (left_left_height >= left_right_height)
+			{
+				return rotate_right(parent, current, left, right_height, left_left_height, left_right, left_right_height, work);
+			} // else, the inner grandchild is the taller.
+
+			{
+				std::lock_guard<spin_lock> left_right_lock{ left_right->lock };
+				left_right_height = left_right->height.load();
+				if (left_left_height >= left_right_height)
+				{
+					return rotate_right(parent, current, left, right_height, left_left_height, left_right, left_right_height, work);
+				} // else, a double rotation, if it leaves left balanced.
+
+				auto left_right_left_height = height_of(left_right->left.load());
+				auto balance = left_left_height - left_right_left_height;
+				if (balance >= -1 && balance <= 1)
+				{
+					return rotate_right_over_left(parent, current, left, right_height, left_left_height, left_right, left_right_left_height, work);
+				} // else, fix left or its right child first.
+			}
+			work.push(current);
+			return left_right_height - left_left_height > 1 ? left : left_right;
+		}
+
+		// the mirror image of rebalance_to_right.
+		static node *rebalance_to_left(node *parent, node *current, node *right, int left_height, repair_list &work)
+		{
+			std::lock_guard<spin_lock> right_lock{ right->lock };
+			auto right_height = right->height.load();
+			if (left_height - right_height >= -1)
+			{
+				return current;
+			} // else, still too tall on the right.
+
+			auto *right_left = right->left.load();
+			auto right_left_height = height_of(right_left);
+			auto right_right_height = height_of(right->right.load());
+			if (right_right_height >= right_left_height)
+			{
+				return rotate_left(parent, current, left_height, right, right_left, right_left_height, right_right_height, work);
+			} // else, the inner grandchild is the taller.
+
+			{
+				std::lock_guard<spin_lock> right_left_lock{ right_left->lock };
+				right_left_height = right_left->height.load();
+				if (right_right_height >= right_left_height)
+				{
+					return rotate_left(parent, current, left_height, right, right_left, right_left_height, right_right_height, work);
+				} // else, a double rotation, if it leaves right balanced.
+
+				auto right_left_right_height = height_of(right_left->right.load());
+				auto balance = right_right_height - right_left_right_height;
+				if (balance >= -1 && balance <= 1)
+				{
+					return rotate_left_over_right(parent, current, left_height, right, right_left, right_right_height, right_left_right_height, work);
+				} // else, fix right or its left child first.
+			}
+			work.push(current);
+			return right_left_height - right_right_height > 1 ? right : right_left;
+		}
+
+		/**
+		 * Rotate current down to the right under its left child, with every
+		 * node involved locked. current's version is marked while it moves,
+		 * as it leaves part of the range it covered. Returns current, the
+		 * deepest node that may still need fixing, after putting left and
+		 * the parent, whose child changed height, on the list.
+		 */
+		static node *rotate_right(node *parent, node *current, node *left, int right_height, int left_left_height, node *left_right, int left_right_height, repair_list &work)
+		{
+			auto version = current->version.load();
+			auto *parent_left = parent->left.load();
+			current->version.store(version | kShrinking);
+
+			current->left.store(left_right);
+			if (left_right != nullptr)
+			{
+				left_right->parent.store(current);
+			} // else, nothing moves across, do_nothing();
+			left->right.store(current);
+			current->parent.store(left);
+			(parent_left == current ? parent->left : parent->right).store(left);
+			left->parent.store(parent);
+
+			auto current_height = 1 + std::max(left_right_height, right_height);
+			current->height.store(current_height);
+			left->height.store(1 + std::max(left_left_height, current_height));
+			current->version.store(version + kShrinkCountIncrement);
+
+			work.push(parent);
+			work.push(left);
+			return current;
+		}
+
+		// the mirror image of rotate_right.
+		static node *rotate_left(node *parent, node *current, int left_height, node *right, node *right_left, int right_left_height, int right_right_height, repair_list &work)
+		{
+			auto version = current->version.load();
+			auto *parent_left = parent->left.load();
+			current->version.store(version | kShrinking);
+
+			current->right.store(right_left);
+			if (right_left != nullptr)
+			{
+				right_left->parent.store(current);
+			} // else, nothing moves across, do_nothing();
+			right->left.store(current);
+			current->parent.store(right);
+			(parent_left == current ? parent->left : parent->right).store(right);
+			right->parent.store(parent);
+
+			auto current_height = 1 + std::max(left_height, right_left_height);
+			current->height.store(current_height);
+			right->height.store(1 + std::max(current_height, right_right_height));
+			current->version.store(version + kShrinkCountIncrement);
+
+			work.push(parent);
+			work.push(right);
+			return current;
+		}
+
+		/**
+		 * Raise current's left child's right child above both of them, with
+		 * all four nodes locked. current and its left child both move down.
+		 * Returns current after putting the rest on the list, as
+		 * rotate_right does.
+		 */
+		static node *rotate_right_over_left(node *parent, node *current, node *left, int right_height, int left_left_height, node *left_right, int left_right_left_height, repair_list &work)
+		{
+			auto version = current->version.load();
+			auto left_version = left->version.load();
+			auto *parent_left = parent->left.load();
+			auto *left_right_left = left_right->left.load();
+			auto *left_right_right = left_right->right.load();
+			auto left_right_right_height = height_of(left_right_right);
+			current->version.store(version | kShrinking);
+			left->version.store(left_version | kShrinking);
+
+			current->left.store(left_right_right);
+			if (left_right_right != nullptr)
+			{
+				left_right_right->parent.store(current);
+			} // else, nothing moves across, do_nothing();
+			left->right.store(left_right_left);
+			if (left_right_left != nullptr)
+			{
+				left_right_left->parent.store(left);
+			} // else, nothing moves across, do_nothing();
+			left_right->left.store(left);
+			left->parent.store(left_right);
+			left_right->right.store(current);
+			current->parent.store(left_right);
+			(parent_left == current ? parent->left : parent->right).store(left_right);
+			left_right->parent.store(parent);
+
+			auto current_height = 1 + std::max(left_right_right_height, right_height);
+			current->height.store(current_height);
+			auto left_height = 1 + std::max(left_left_height, left_right_left_height);
+			left->height.store(left_height);
+			left_right->height.store(1 + std::max(left_height, current_height));
+			current->version.store(version + kShrinkCountIncrement);
+			left->version.store(left_version + kShrinkCountIncrement);
+
+			work.push(parent);
+			work.push(left_right);
+			work.push(left);
+			return current;
+		}
+
+		// the mirror image of rotate_right_over_left.
+		static node *rotate_left_over_right(node *parent, node *current, int left_height, node *right, node *right_left, int right_right_height, int right_left_right_height, repair_list &work)
+		{
+			auto version = current->version.load();
+			auto right_version = right->version.load();
+			auto *parent_left = parent->left.load();
+			auto *right_left_left = right_left->left.load();
+			auto *right_left_right = right_left->right.load();
+			auto right_left_left_height = height_of(right_left_left);
+			current->version.store(version | kShrinking);
+			right->version.store(right_version | kShrinking);
+
+			current->right.store(right_left_left);
+			if (right_left_left != nullptr)
+			{
+				right_left_left->parent.store(current);
+			} // else, nothing moves across, do_nothing();
+			right->left.store(right_left_right);
+			if (right_left_right != nullptr)
+			{
+				right_left_right->parent.store(right);
+			} // else, nothing moves across, do_nothing();
+			right_left->right.store(right);
+			right->parent.store(right_left);
+			right_left->left.store(current);
+			current->parent.store(right_left);
+			(parent_left == current ? parent->left : parent->right).store(right_left);
+			right_left->parent.store(parent);
+
+			auto current_height = 1 + std::max(left_height, right_left_left_height);
+			current->height.store(current_height);
+			auto right_height = 1 + std::max(right_left_right_height, right_right_height);
+			right->height.store(right_height);
+			right_left->height.store(1 + std::max(current_height, right_height));
+			current->version.store(version + kShrinkCountIncrement);
+			right->version.store(right_version + kShrinkCountIncrement);
+
+			work.push(parent);
+			work.push(right_left);
+			work.push(right);
+			return current;
+		}
+
+		void empty(node *current)
+		{
+			if (current != nullptr)
+			{
+				this->empty(current->left.load(std::memory_order_relaxed));
+				this->empty(current->right.load(std::memory_order_relaxed));
+				delete current;
+			}
+		}
+	};
+}
+
+#endif // CONCURRENT_TREE_H_
@@ -0,0 +1,212 @@
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nwacc
+{
+	/**
+	 * Epoch based reclamation for lock-free containers. A thread pins the
+	 * domain for as long as it may hold pointers into shared nodes, and
+	 * nodes that have been unlinked are retired rather than deleted. A
+	 * retired node is deleted once the global epoch has moved on twice,
+	 * which can only happen after every thread that might have seen it
+	 * has unpinned.
+	 *
+	 * Pinning costs one compare and swap on a slot of its own cache line.
+	 * Retiring takes a mutex, so it is meant for writers; a thread that
+	 * retires on every operation can hand its guard to retire, which keeps
+	 * the objects in the pinned slot and only takes the mutex once a batch
+	 * of them has piled up.
+	 */
+	class epoch_domain
+	{
+	private:
+		struct padded_slot;
+	public:
+		/**
+		 * Keeps the domain pinned until it goes out of scope.
+		 */
+		class guard
+		{
+		public:
+			guard(guard &&rhs) noexcept : slot{ rhs.slot }
+			{
+				rhs.slot = nullptr;
+			}
+
+			guard(const guard &rhs) = delete;
+			guard &operator=(const guard &rhs) = delete;
+
+			~guard()
+			{
+				if (this->slot != nullptr)
+				{
+					this->slot->epoch.store(0, std::memory_order_release);
+				} // else, moved from, do_nothing();
+			}
+
+		private:
+			padded_slot *slot;
+
+			explicit guard(padded_slot *slot) : slot{ slot } {}
+
+			friend class epoch_domain;
+		};
+
+		epoch_domain() : global_epoch{ 1 }, retired_since_advance{ 0 }
+		{
+			for (auto &slot : this->slots)
+			{
+				slot.epoch.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		epoch_domain(const epoch_domain &rhs) = delete;
+		epoch_domain &operator=(const epoch_domain &rhs) = delete;
+
+		~epoch_domain()
+		{
+			for (auto &list : this->limbo)
+			{
+				free_all(list);
+			}
+			for (auto &slot : this->slots)
+			{
+				free_all(slot.pending);
+			}
+		}
+
+		/**
+		 * Announce that the calling thread is about to read shared nodes.
+		 * Each thread starts looking for a free slot at its own hashed
+		 * position, so threads rarely contend for the same one.
+		 */
+		guard pin()
+		{
+			static thread_local std::size_t hint = std::hash<std::thread::id>{}(std::this_thread::get_id());
+			for (auto index = hint;; index++)
+			{
+				auto &slot = this->slots[index % kSlots];
+				std::uint64_t idle = 0;
+				if (slot.epoch.load(std::memory_order_relaxed) == 0 &&
+					slot.epoch.compare_exchange_strong(idle, this->global_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+				{
+					hint = index;
+					return guard(&slot);
+				} // else, taken by another thread, try the next one.
+			}
+		}
+
+		/**
+		 * Hand over an unlinked object to be deleted once no pinned thread
+		 * can still be looking at it.
+		 */
+		template <typename T>
+		void retire(const T *object)
+		{
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			auto epoch = this->global_epoch.load(std::memory_order_relaxed);
+			this->limbo[epoch % 3].push_back({ const_cast<T *>(object), &destroy<T> });
+			if (++this->retired_since_advance >= kAdvanceInterval)
+			{
+				this->try_advance();
+			} // else, let a few more pile up before scanning, do_nothing();
+		}
+
+		/**
+		 * Retire an object from a thread holding pinned. The object waits
+		 * in the pinned slot and moves to the shared lists, under the
+		 * mutex, with the rest of its batch. Those lists go by the epoch
+		 * the batch moves in, never earlier than the one each object was
+		 * unlinked in, so waiting only delays the delete.
+		 */
+		template <typename T>
+		void retire(const guard &pinned, const T *object)
+		{
+			auto &pending = pinned.slot->pending;
+			pending.push_back({ const_cast<T *>(object), &destroy<T> });
+			if (pending.size() < kAdvanceInterval)
+			{
+				return;
+			} // else, a full batch, hand it over.
+
+			std::lock_guard<std::mutex> lock{ this->mutex };
+			auto &list = this->limbo[this->global_epoch.load(std::memory_order_relaxed) % 3];
+			list.insert(list.end(), pending.begin(), pending.end());
+			pending.clear();
+			this->retired_since_advance += kAdvanceInterval;
+			this->try_advance();
+		}
+
+	private:
+		static const std::size_t kSlots = 128;
+		static const std::size_t kAdvanceInterval = 64;
+
+		struct retired
+		{
+			void *object;
+			void (*deleter)(void *);
+		};
+
+		struct alignas(64) padded_slot
+		{
+			// the epoch the owning thread pinned in, or 0 when free.
+			std::atomic<std::uint64_t> epoch;
+			// objects retired through a guard on this slot, only touched
+			// by the thread that has it pinned.
+			std::vector<retired> pending;
+		};
+
+		padded_slot slots[kSlots];
+		std::atomic<std::uint64_t> global_epoch;
+		std::mutex mutex;
+		std::vector<retired> limbo[3];
+		std::size_t retired_since_advance;
+
+		template <typename T>
+		static void destroy(void *object)
+		{
+			delete static_cast<T *>(object);
+		}
+
+		static void free_all(std::vector<retired> &list)
+		{
+			for (auto &entry : list)
+			{
+				entry.deleter(entry.object);
+			}
+			list.clear();
+		}
+
+		/**
+		 * Move the global epoch forward if every pinned thread has caught up
+		 * with it, then free what was retired two epochs ago. Called with
+		 * the mutex held.
+		 */
+		void try_advance()
+		{
+			auto epoch = this->global_epoch.load(std::memory_order_seq_cst);
+			for (auto &slot : this->slots)
+			{
+				auto pinned = slot.epoch.load(std::memory_order_seq_cst);
+				if (pinned != 0 && pinned != epoch)
+				{
+					return;
+				} // else, this thread is idle or current, do_nothing();
+			}
+
+			this->global_epoch.store(epoch + 1, std::memory_order_seq_cst);
+			free_all(this->limbo[(epoch + 2) % 3]);
+			this->retired_since_advance = 0;
+		}
+	};
+}
+
+#endif // EPOCH_H_
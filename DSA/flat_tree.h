@@ -0,0 +1,483 @@
+#ifndef FLAT_TREE_H_
+#define FLAT_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <xmmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace nwacc
+{
+	/**
+	 * Searching a sorted array stored in Eytzinger (breadth first) order.
+	 * The array is 1-based: the children of index k are 2k and 2k + 1, and
+	 * index 0 is unused and stands for "not found". Every search touches
+	 * the same first few cache lines, and the children of a node are next
+	 * to each other, so the next levels can be prefetched while comparing.
+	 */
+	namespace eytzinger
+	{
+		/**
+		 * Return the number of consecutive one bits at the bottom of value.
+		 */
+		inline int trailing_ones(std::size_t value)
+		{
+#if defined(_MSC_VER) && defined(_WIN64)
+			unsigned long index;
+			_BitScanForward64(&index, ~value);
+			return static_cast<int>(index);
+#elif defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward(&index, static_cast<unsigned long>(~value));
+			return static_cast<int>(index);
+#else
+			return __builtin_ctzll(~static_cast<unsigned long long>(value));
+#endif
+		}
+
+		template <typename T>
+		inline void prefetch(const T *address)
+		{
+#if defined(_MSC_VER)
+			_mm_prefetch(reinterpret_cast<const char *>(address), _MM_HINT_T0);
+#else
+			__builtin_prefetch(address);
+#endif
+		}
+
+		/**
+		 * How far apart the grandchildren four levels down are, in elements.
+		 * They all share one cache line once it is at least 16 elements wide.
+		 */
+		template <typename T>
+		constexpr std::size_t prefetch_stride()
+		{
+			return sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+		}
+
+		/**
+		 * Return the index of the first element that is not less than key,
+		 * or 0 if every element is less. The loop has no data dependent
+		 * branches; the answer is recovered from the path taken by dropping
+		 * the trailing right turns and the final left turn.
+		 */
+		template <typename T, typename Key>
+		std::size_t lower_bound(const T *elements, std::size_t n, const Key &key)
+		{
+			std::size_t index = 1;
+			while (index <= n)
+			{
+				prefetch(elements + index * prefetch_stride<T>());
+				index = 2 * index + (elements[index] < key);
+			}
+			return index >> (trailing_ones(index) + 1);
+		}
+
+		/**
+		 * Return the index of the first element greater than key, or 0.
+		 */
+		template <typename T, typename Key>
+		std::size_t upper_bound(const T *elements, std::size_t n, const Key &key)
+		{
+			std::size_t index = 1;
+			while (index <= n)
+			{
+				prefetch(elements + index * prefetch_stride<T>());
+				index = 2 * index + !(key < elements[index]);
+			}
+			return index >> (trailing_ones(index) + 1);
+		}
+
+		/**
+		 * Return the number of levels of the implicit tree that are
+		 * completely filled; a descent of that many steps never leaves the
+		 * array.
+		 */
+		inline std::size_t full_levels(std::size_t n)
+		{
+			std::size_t levels = 0;
+			while ((std::size_t{ 2 } << levels) - 1 <= n)
+			{
+				levels++;
+			}
+			return levels;
+		}
+
+		/**
+		 * Vectorized batch lookup, for builds without AVX2 or key types it
+		 * does not cover. Handles no keys.
+		 */
+		template <typename T>
+		std::size_t contains_many_simd(const T *, std::size_t, const T *, std::size_t, bool *)
+		{
+			return 0;
+		}
+
+#if defined(__AVX2__)
+		/**
+		 * Look up eight int keys at a time, one per 32-bit lane. Every lane
+		 * descends the complete levels in lockstep with a gather and a
+		 * compare per level, then the lanes that still point inside the
+		 * array take one masked step into the partial bottom level. Returns
+		 * how many keys were handled; the rest are left to the scalar loop.
+		 */
+		inline std::size_t contains_many_simd(const int *elements, std::size_t n, const int *keys, std::size_t count, bool *out)
+		{
+			if (n >= (std::size_t{ 1 } << 30))
+			{
+				// indices would overflow a 32-bit lane.
+				return 0;
+			} // else, every index fits, do_nothing();
+
+			const auto levels = full_levels(n);
+			const auto one = _mm256_set1_epi32(1);
+			const auto past_end = _mm256_set1_epi32(static_cast<int>(n + 1));
+			std::size_t done = 0;
+			for (; done + 8 <= count; done += 8)
+			{
+				auto key = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + done));
+				auto index = one;
+				for (std::size_t level = 0; level < levels; level++)
+				{
+					auto value = _mm256_i32gather_epi32(elements, index, 4);
+					// all ones (minus one) where the element is less than the key.
+					auto less = _mm256_cmpgt_epi32(key, value);
+					index = _mm256_sub_epi32(_mm256_add_epi32(index, index), less);
+				}
+
+				auto inside = _mm256_cmpgt_epi32(past_end, index);
+				auto value = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), elements, index, inside, 4);
+				auto less = _mm256_and_si256(_mm256_cmpgt_epi32(key, value), inside);
+				auto stepped = _mm256_sub_epi32(_mm256_add_epi32(index, index), less);
+				index = _mm256_blendv_epi8(index, stepped, inside);
+
+				alignas(32) int indices[8];
+				_mm256_store_si256(reinterpret_cast<__m256i *>(indices), index);
+				for (auto lane = 0; lane < 8; lane++)
+				{
+					auto found = static_cast<std::size_t>(indices[lane]);
+					found >>= trailing_ones(found) + 1;
+					out[done + lane] = found != 0 && elements[found] == keys[done + lane];
+				}
+			}
+			return done;
+		}
+#endif
+
+		/**
+		 * Look up a batch of keys, writing whether each is present to the
+		 * matching slot of out. Groups of keys descend together level by
+		 * level, so the cache misses of one group overlap instead of each
+		 * lookup waiting on its own.
+		 */
+		template <typename T>
+		void contains_many(const T *elements, std::size_t n, const T *keys, std::size_t count, bool *out)
+		{
+			const std::size_t kLanes = 16;
+			if (n == 0)
+			{
+				std::fill(out, out + count, false);
+				return;
+			} // else, there is something to search.
+
+			const auto levels = full_levels(n);
+			auto done = contains_many_simd(elements, n, keys, count, out);
+			for (; done < count; done += kLanes)
+			{
+				const auto lanes = std::min(kLanes, count - done);
+				std::size_t index[kLanes];
+				std::fill(index, index + lanes, std::size_t{ 1 });
+				for (std::size_t level = 0; level < levels; level++)
+				{
+					for (std::size_t lane = 0; lane < lanes; lane++)
+					{
+						prefetch(elements + index[lane] * prefetch_stride<T>());
+						index[lane] = 2 * index[lane] + (elements[index[lane]] < keys[done + lane]);
+					}
+				}
+
+				for (std::size_t lane = 0; lane < lanes; lane++)
+				{
+					if (index[lane] <= n)
+					{
+						index[lane] = 2 * index[lane] + (elements[index[lane]] < keys[done + lane]);
+					} // else, this lane already fell off the bottom, do_nothing();
+
+					auto found = index[lane] >> (trailing_ones(index[lane]) + 1);
+					out[done + lane] = found != 0 && !(keys[done + lane] < elements[found]);
+				}
+			}
+		}
+
+		/**
+		 * Return the index holding the smallest element, or 0 if empty.
+		 */
+		inline std::size_t first(std::size_t n)
+		{
+			if (n == 0)
+			{
+				return 0;
+			} // else, follow the left children down.
+
+			std::size_t index = 1;
+			while (2 * index <= n)
+			{
+				index = 2 * index;
+			}
+			return index;
+		}
+
+		/**
+		 * Return the index holding the largest element, or 0 if empty.
+		 */
+		inline std::size_t last(std::size_t n)
+		{
+			if (n == 0)
+			{
+				return 0;
+			} // else, follow the right children down.
+
+			std::size_t index = 1;
+			while (2 * index + 1 <= n)
+			{
+				index = 2 * index + 1;
+			}
+			return index;
+		}
+
+		/**
+		 * Return the index of the in-order successor, or 0 after the last.
+		 * If there is a right subtree, take its left most index. Otherwise
+		 * climb while we are a right child and step to the parent.
+		 */
+		inline std::size_t next(std::size_t index, std::size_t n)
+		{
+			if (2 * index + 1 <= n)
+			{
+				index = 2 * index + 1;
+				while (2 * index <= n)
+				{
+					index = 2 * index;
+				}
+				return index;
+			} // else, climb back up.
+
+			return index >> (trailing_ones(index) + 1);
+		}
+
+		/**
+		 * Return the index of the in-order predecessor. Stepping back from
+		 * 0 (the end) lands on the last element.
+		 */
+		inline std::size_t previous(std::size_t index, std::size_t n)
+		{
+			if (index == 0)
+			{
+				return last(n);
+			}
+			else if (2 * index <= n)
+			{
+				index = 2 * index;
+				while (2 * index + 1 <= n)
+				{
+					index = 2 * index + 1;
+				}
+				return index;
+			} // else, climb while we are a left child and step to the parent.
+
+			while (index != 0 && (index & 1) == 0)
+			{
+				index >>= 1;
+			}
+			return index >> 1;
+		}
+	}
+
+	/**
+	 * An immutable, contiguous snapshot of a sorted set, laid out in
+	 * Eytzinger order for cache friendly lookups. Build one with
+	 * tree::freeze, or directly from a sorted range of unique values.
+	 */
+	template <typename T>
+	class flat_tree
+	{
+	public:
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() : owner{ nullptr }, index{ 0 } {}
+
+			const T &operator*() const
+			{
+				return this->owner->elements[this->index];
+			}
+
+			const T *operator->() const
+			{
+				return &this->owner->elements[this->index];
+			}
+
+			const_iterator &operator++()
+			{
+				this->index = eytzinger::next(this->index, this->owner->size());
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			const_iterator &operator--()
+			{
+				this->index = eytzinger::previous(this->index, this->owner->size());
+				return *this;
+			}
+
+			const_iterator operator--(int)
+			{
+				auto old = *this;
+				--(*this);
+				return old;
+			}
+
+			bool operator== (const const_iterator &rhs) const
+			{
+				return this->index == rhs.index;
+			}
+
+			bool operator!= (const const_iterator &rhs) const
+			{
+				return !(*this == rhs);
+			}
+
+		private:
+			const flat_tree *owner;
+			std::size_t index;
+
+			const_iterator(const flat_tree *owner, std::size_t index) : owner{ owner }, index{ index } {}
+
+			friend class flat_tree;
+		};
+
+		using iterator = const_iterator;
+
+		flat_tree() {}
+
+		/**
+		 * Build the snapshot from a sorted range without duplicates.
+		 */
+		template <typename ForwardIterator>
+		flat_tree(ForwardIterator first, ForwardIterator last)
+		{
+			this->assign(first, last);
+		}
+
+		/**
+		 * Replace the contents with a sorted range without duplicates. The
+		 * range is read once, in order, while the in-order walk of the
+		 * implicit tree decides where each value goes.
+		 */
+		template <typename ForwardIterator>
+		void assign(ForwardIterator first, ForwardIterator last)
+		{
+			auto n = static_cast<std::size_t>(std::distance(first, last));
+			this->elements.clear();
+			this->elements.resize(n + 1);
+			for (auto index = eytzinger::first(n); index != 0; index = eytzinger::next(index, n))
+			{
+				this->elements[index] = *first;
+				++first;
+			}
+		}
+
+		std::size_t size() const
+		{
+			return this->elements.empty() ? 0 : this->elements.size() - 1;
+		}
+
+		bool is_empty() const
+		{
+			return this->size() == 0;
+		}
+
+		bool contains(const T &value) const
+		{
+			auto index = eytzinger::lower_bound(this->elements.data(), this->size(), value);
+			return index != 0 && !(value < this->elements[index]);
+		}
+
+		/**
+		 * Look up count keys at once, writing whether each is present to
+		 * the matching slot of out. The lookups are interleaved, and with
+		 * AVX2 enabled, int keys are searched eight to a vector.
+		 */
+		void contains_many(const T *keys, std::size_t count, bool *out) const
+		{
+			eytzinger::contains_many(this->elements.data(), this->size(), keys, count, out);
+		}
+
+		/**
+		 * Return the first element that is not less than value.
+		 */
+		const_iterator lower_bound(const T &value) const
+		{
+			return const_iterator(this, eytzinger::lower_bound(this->elements.data(), this->size(), value));
+		}
+
+		/**
+		 * Return the first element that is greater than value.
+		 */
+		const_iterator upper_bound(const T &value) const
+		{
+			return const_iterator(this, eytzinger::upper_bound(this->elements.data(), this->size(), value));
+		}
+
+		/**
+		 * Return the elements in [low, high) as a pair of iterators.
+		 */
+		std::pair<const_iterator, const_iterator> range(const T &low, const T &high) const
+		{
+			if (high < low)
+			{
+				return { this->end(), this->end() };
+			} // else, the bounds are in order, do_nothing();
+
+			return { this->lower_bound(low), this->lower_bound(high) };
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, eytzinger::first(this->size()));
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, 0);
+		}
+
+	private:
+		// slot 0 is unused so that the children of k are 2k and 2k + 1.
+		std::vector<T> elements;
+	};
+}
+
+#endif // FLAT_TREE_H_
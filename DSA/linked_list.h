@@ -2,11 +2,22 @@
 #define LINKED_LIST_H_
 
 #include <algorithm>
-#include <ppltasks.h>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+
+#include "node_pool.h"
 
 namespace nwacc
 {
-	template <typename T>
+	/**
+	 * Nodes, including the head and tail sentinels, are obtained from the
+	 * Allocator rebound to the node type.
+	 */
+	template <typename T, typename Allocator = std::allocator<T>>
 	class linked_list
 	{
 	private:
@@ -87,7 +98,7 @@ namespace nwacc
 
 			const_iterator(node *current) : current{ current } {}
 
-			friend class linked_list<T>;
+			friend class linked_list;
 		};
 
 		// This is the IS-A relationship. We now say
@@ -143,7 +154,7 @@ namespace nwacc
 			// Expects the current position.
 			iterator(node *current) : const_iterator{ current } { }
 
-			friend class linked_list<T>;
+			friend class linked_list;
 		};
 
 		linked_list()
@@ -151,7 +162,13 @@ namespace nwacc
 			this->init();
 		}
 
+		explicit linked_list(const Allocator & allocator) : allocator{ allocator }
+		{
+			this->init();
+		}
+
 		linked_list(const linked_list & rhs)
+			: allocator{ node_traits::select_on_container_copy_construction(rhs.allocator) }
 		{
 			this->init();
 			for (auto &value : rhs)
@@ -162,13 +179,19 @@ namespace nwacc
 
 		~linked_list()
 		{
+			if (std::is_trivially_destructible<T>::value && releases_in_bulk<node_allocator>::on_destruction(this->allocator))
+			{
+				// the allocator gives back every node at once when it goes away.
+				return;
+			} // else, every node has to be destroyed on its own.
+
 			this->clear();
-			delete this->head;
-			delete this->tail;
+			this->destroy_node(this->head);
+			this->destroy_node(this->tail);
 		}
 
 		linked_list(linked_list && rhs)
-			: my_size{ rhs.my_size }, head{ rhs.head }, tail{ rhs.tail }
+			: my_size{ rhs.my_size }, head{ rhs.head }, tail{ rhs.tail }, allocator{ rhs.allocator }
 		{
 			rhs.my_size = 0;
 			rhs.head = nullptr;
@@ -180,6 +203,7 @@ namespace nwacc
 			std::swap(this->my_size, rhs.my_size);
 			std::swap(this->head, rhs.head);
 			std::swap(this->tail, rhs.tail);
+			std::swap(this->allocator, rhs.allocator);
 			return *this;
 		}
 
@@ -286,7 +310,7 @@ namespace nwacc
 			this->my_size++;
 			return iterator(
 				current->previous = current->previous->next =
-				new node{ value, current->previous, current });
+				this->create_node(value, current->previous, current));
 		}
 
 		iterator insert(iterator current_iterator, T && value)
@@ -295,7 +319,7 @@ namespace nwacc
 			this->my_size++;
 			return iterator(
 				current->previous = current->previous->next =
-				new node{ std::move(value), current->previous, current });
+				this->create_node(std::move(value), current->previous, current));
 		}
 
 		// This will remove the value AT iterator. 
@@ -305,24 +329,332 @@ namespace nwacc
 			iterator value(current->previous);
 			current->previous->next = current->next;
 			current->next->previous = current->previous;
-			delete current;
+			this->destroy_node(current);
 			this->my_size--;
 			return value;
 		}
 
+		/**
+		 * Move every value of other in BEFORE iterator. The nodes are
+		 * relinked, in O(1), when the two allocators compare equal;
+		 * otherwise the values are moved into nodes from this list's
+		 * allocator. other is left empty.
+		 */
+		void splice(iterator position, linked_list & other)
+		{
+			if (&other == this || other.is_empty())
+			{
+				return;
+			} // else, there are values to take.
+
+			this->splice(position, other, other.begin(), other.end(), other.size());
+		}
+
+		// move the single value AT element of other in BEFORE iterator.
+		void splice(iterator position, linked_list & other, iterator element)
+		{
+			auto next = element;
+			this->splice(position, other, element, ++next, 1);
+		}
+
+		/**
+		 * Move the values of [first, last) of other in BEFORE iterator,
+		 * which must not be inside the range. Relinking is O(1), but the
+		 * range has to be counted when it moves to another list.
+		 */
+		void splice(iterator position, linked_list & other, iterator first, iterator last)
+		{
+			if (&other == this)
+			{
+				this->transfer(position.current, first.current, last.current);
+				return;
+			} // else, both sizes change.
+
+			int count = 0;
+			for (auto current = first; current != last; ++current)
+			{
+				count++;
+			}
+			this->splice(position, other, first, last, count);
+		}
+
+		/**
+		 * Merge the values of other, which like this list must be sorted
+		 * by compare, into this list, leaving other empty. Equal values
+		 * from this list stay in front of those from other. The nodes are
+		 * relinked, so nothing is allocated when the two allocators compare
+		 * equal.
+		 */
+		template <typename Compare = std::less<T>>
+		void merge(linked_list & other, Compare compare = Compare{})
+		{
+			if (&other == this || other.is_empty())
+			{
+				return;
+			}
+			else if (!(this->allocator == other.allocator))
+			{
+				// move each value of other into a node of our own.
+				auto position = this->begin();
+				for (auto &value : other)
+				{
+					while (position != this->end() && !compare(value, *position))
+					{
+						++position;
+					}
+					this->insert(position, std::move(value));
+				}
+				other.clear();
+				return;
+			} // else, the nodes can change hands.
+
+			auto count = this->my_size + other.my_size;
+			auto *merged = merge_chains(this->detach(), other.detach(), compare);
+			this->attach(merged, count);
+		}
+
+		/**
+		 * Sort the values by compare with a stable bottom-up merge sort
+		 * that relinks the nodes rather than moving any value, so nothing
+		 * is allocated or copied. Given more than one thread, a large list
+		 * is cut into pieces sorted on up to threads threads, each with a
+		 * copy of compare, and merged back together; the copies are called
+		 * at the same time, so only ask for threads when that is safe.
+		 * compare must not throw.
+		 */
+		template <typename Compare = std::less<T>>
+		void sort(Compare compare = Compare{}, unsigned threads = 1)
+		{
+			if (this->my_size < 2)
+			{
+				return;
+			} // else, there is something to sort.
+
+			auto count = this->my_size;
+			auto *sorted = sort_chain(this->detach(), static_cast<std::size_t>(count), compare, threads);
+			this->attach(sorted, count);
+		}
+
 	private:
 
+		using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+		using node_traits = std::allocator_traits<node_allocator>;
+
 		int my_size;
 		node * head;
 		node * tail;
+		node_allocator allocator;
+
+		template <typename... Args>
+		node * create_node(Args &&... args)
+		{
+			auto *current = node_traits::allocate(this->allocator, 1);
+			try
+			{
+				node_traits::construct(this->allocator, current, std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				node_traits::deallocate(this->allocator, current, 1);
+				throw;
+			}
+			return current;
+		}
+
+		void destroy_node(node * current)
+		{
+			if (current != nullptr)
+			{
+				node_traits::destroy(this->allocator, current);
+				node_traits::deallocate(this->allocator, current, 1);
+			} // else, a moved-from list has no sentinels, do_nothing();
+		}
 
 		void init()
 		{
 			this->my_size = 0;
-			this->head = new node;
-			this->tail = new node;
+			this->head = this->create_node();
+			this->tail = this->create_node();
+			this->head->next = this->tail;
+			this->tail->previous = this->head;
+		}
+
+		// below this many values sort stops cutting the list for threads.
+		static const std::size_t kParallelSortCutoff = 1 << 16;
+
+		/**
+		 * Move the values of [first, last) of other in before position,
+		 * with count the length of the range.
+		 */
+		void splice(iterator position, linked_list & other, iterator first, iterator last, int count)
+		{
+			if (first == last)
+			{
+				return;
+			}
+			else if (!(this->allocator == other.allocator))
+			{
+				while (first != last)
+				{
+					this->insert(position, std::move(*first));
+					other.erase(first++);
+				}
+				return;
+			} // else, the nodes can change hands.
+
+			this->transfer(position.current, first.current, last.current);
+			this->my_size += count;
+			other.my_size -= count;
+		}
+
+		// unlink [first, last) and link it back in before position.
+		static void transfer(node * position, node * first, node * last)
+		{
+			if (first == last || position == first || position == last)
+			{
+				return;
+			} // else, the range has to move.
+
+			auto *back = last->previous;
+			first->previous->next = last;
+			last->previous = first->previous;
+
+			back->next = position;
+			first->previous = position->previous;
+			position->previous->next = first;
+			position->previous = back;
+		}
+
+		/**
+		 * Take the values out from between the sentinels as a chain linked
+		 * only through next and ended by nullptr.
+		 */
+		node * detach()
+		{
+			if (this->is_empty())
+			{
+				return nullptr;
+			} // else, there is a chain to take.
+
+			auto *first = this->head->next;
+			this->tail->previous->next = nullptr;
 			this->head->next = this->tail;
 			this->tail->previous = this->head;
+			this->my_size = 0;
+			return first;
+		}
+
+		// put a chain of count values back, mending the previous links.
+		void attach(node * first, int count)
+		{
+			auto *previous = this->head;
+			for (auto *current = first; current != nullptr; current = current->next)
+			{
+				current->previous = previous;
+				previous->next = current;
+				previous = current;
+			}
+			previous->next = this->tail;
+			this->tail->previous = previous;
+			this->my_size = count;
+		}
+
+		/**
+		 * Merge two sorted chains into one, taking from first while its
+		 * value is not greater, so the merge is stable.
+		 */
+		template <typename Compare>
+		static node * merge_chains(node * first, node * second, Compare & compare)
+		{
+			node *merged = nullptr;
+			node **end = &merged;
+			while (first != nullptr && second != nullptr)
+			{
+				if (compare(second->data, first->data))
+				{
+					*end = second;
+					second = second->next;
+				}
+				else
+				{
+					*end = first;
+					first = first->next;
+				}
+				end = &(*end)->next;
+			}
+			*end = first != nullptr ? first : second;
+			return merged;
+		}
+
+		/**
+		 * Sort a chain of count values. Above the cutoff, with threads to
+		 * spare, the chain is cut in half, the first half sorted on a new
+		 * thread and the two merged. Otherwise each value is merged into
+		 * an array of runs where run i holds 2^i values, as a binary
+		 * counter carries, and the runs are merged together at the end.
+		 */
+		template <typename Compare>
+		static node * sort_chain(node * first, std::size_t count, Compare & compare, unsigned threads)
+		{
+			if (threads > 1 && count >= kParallelSortCutoff)
+			{
+				auto half = count / 2;
+				auto *cut = first;
+				for (std::size_t index = 1; index < half; index++)
+				{
+					cut = cut->next;
+				}
+				auto *second = cut->next;
+				cut->next = nullptr;
+
+				std::future<node *> task;
+				try
+				{
+					// the new thread gets its own copy of compare.
+					task = std::async(std::launch::async, [&, compare]() mutable { return sort_chain(first, half, compare, threads / 2); });
+				}
+				catch (const std::system_error &)
+				{
+					// no thread to be had, sort both halves here.
+					first = sort_chain(first, half, compare, 1);
+					second = sort_chain(second, count - half, compare, threads - threads / 2);
+					return merge_chains(first, second, compare);
+				}
+
+				second = sort_chain(second, count - half, compare, threads - threads / 2);
+				first = task.get();
+				return merge_chains(first, second, compare);
+			} // else, sort it on this thread.
+
+			// enough runs for any list that fits in memory.
+			node *runs[64] = {};
+			auto used = 0;
+			while (first != nullptr)
+			{
+				auto *carry = first;
+				first = first->next;
+				carry->next = nullptr;
+
+				auto run = 0;
+				for (; runs[run] != nullptr; run++)
+				{
+					// the run holds the earlier values, so it goes first.
+					carry = merge_chains(runs[run], carry, compare);
+					runs[run] = nullptr;
+				}
+				runs[run] = carry;
+				used = std::max(used, run + 1);
+			}
+
+			node *sorted = nullptr;
+			for (auto run = 0; run < used; run++)
+			{
+				if (runs[run] != nullptr)
+				{
+					sorted = merge_chains(runs[run], sorted, compare);
+				} // else, an empty run, do_nothing();
+			}
+			return sorted;
 		}
 	};
 
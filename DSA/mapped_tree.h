@@ -0,0 +1,247 @@
+#ifndef MAPPED_TREE_H_
+#define MAPPED_TREE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "flat_tree.h"
+#include "tree_file.h"
+
+namespace nwacc
+{
+	/**
+	 * A whole file mapped read only into memory, with mmap on POSIX
+	 * systems and a file mapping on Windows. Pages are only read from disk
+	 * when they are first touched. Throws std::runtime_error if the file
+	 * cannot be opened or mapped.
+	 */
+	class mapped_file
+	{
+	public:
+		mapped_file() : bytes{ nullptr }, length{ 0 } {}
+
+		explicit mapped_file(const std::string &path) : bytes{ nullptr }, length{ 0 }
+		{
+#if defined(_WIN32)
+			auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+			{
+				throw std::runtime_error("Cannot open file: " + path);
+			} // else, find out how much to map.
+
+			LARGE_INTEGER file_size;
+			if (!::GetFileSizeEx(file, &file_size))
+			{
+				::CloseHandle(file);
+				throw std::runtime_error("Cannot size file: " + path);
+			} // else, map the whole thing.
+
+			this->length = static_cast<std::size_t>(file_size.QuadPart);
+			if (this->length != 0)
+			{
+				auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				if (mapping != nullptr)
+				{
+					this->bytes = static_cast<const char *>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+					// the view keeps the mapping alive.
+					::CloseHandle(mapping);
+				} // else, bytes stays null and we fail below.
+			} // else, an empty file has nothing to map, do_nothing();
+
+			::CloseHandle(file);
+#else
+			auto file = ::open(path.c_str(), O_RDONLY);
+			if (file < 0)
+			{
+				throw std::runtime_error("Cannot open file: " + path);
+			} // else, find out how much to map.
+
+			struct stat status;
+			if (::fstat(file, &status) != 0)
+			{
+				::close(file);
+				throw std::runtime_error("Cannot size file: " + path);
+			} // else, map the whole thing.
+
+			this->length = static_cast<std::size_t>(status.st_size);
+			if (this->length != 0)
+			{
+				auto *address = ::mmap(nullptr, this->length, PROT_READ, MAP_SHARED, file, 0);
+				if (address != MAP_FAILED)
+				{
+					this->bytes = static_cast<const char *>(address);
+				} // else, bytes stays null and we fail below.
+			} // else, an empty file has nothing to map, do_nothing();
+
+			// the mapping keeps the file alive.
+			::close(file);
+#endif
+			if (this->length != 0 && this->bytes == nullptr)
+			{
+				throw std::runtime_error("Cannot map file: " + path);
+			} // else, mapped, do_nothing();
+		}
+
+		mapped_file(const mapped_file &rhs) = delete;
+		mapped_file &operator=(const mapped_file &rhs) = delete;
+
+		mapped_file(mapped_file &&rhs) noexcept : bytes{ rhs.bytes }, length{ rhs.length }
+		{
+			rhs.bytes = nullptr;
+			rhs.length = 0;
+		}
+
+		mapped_file &operator=(mapped_file &&rhs) noexcept
+		{
+			std::swap(this->bytes, rhs.bytes);
+			std::swap(this->length, rhs.length);
+			return *this;
+		}
+
+		~mapped_file()
+		{
+			if (this->bytes == nullptr)
+			{
+				return;
+			} // else, give the pages back.
+
+#if defined(_WIN32)
+			::UnmapViewOfFile(this->bytes);
+#else
+			::munmap(const_cast<char *>(this->bytes), this->length);
+#endif
+		}
+
+		const char *data() const
+		{
+			return this->bytes;
+		}
+
+		std::size_t size() const
+		{
+			return this->length;
+		}
+
+	private:
+		const char *bytes;
+		std::size_t length;
+	};
+
+	/**
+	 * A read only set of values queried directly in a file written by
+	 * tree::save, with nothing to parse or build: opening one only maps
+	 * the file and checks its header. Files saved with the Eytzinger
+	 * layout are searched with the same code as flat_tree; sorted files
+	 * with a binary search.
+	 */
+	template <typename T>
+	class mapped_tree
+	{
+	public:
+		explicit mapped_tree(const std::string &path) : file{ path }
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be mapped");
+			if (this->file.size() < sizeof(tree_file::header))
+			{
+				throw std::runtime_error("Tree file is too short: " + path);
+			} // else, there is a header to check.
+
+			auto *file_header = reinterpret_cast<const tree_file::header *>(this->file.data());
+			tree_file::check_header(*file_header, sizeof(T), path);
+			tree_file::check_count(*file_header, this->file.size() - sizeof(tree_file::header), sizeof(T), path);
+
+			this->count = static_cast<std::size_t>(file_header->count);
+			this->element_layout = static_cast<tree_file::layout>(file_header->element_layout);
+			this->elements = reinterpret_cast<const T *>(this->file.data() + sizeof(tree_file::header));
+		}
+
+		std::size_t size() const
+		{
+			return this->count;
+		}
+
+		bool is_empty() const
+		{
+			return this->count == 0;
+		}
+
+		tree_file::layout layout() const
+		{
+			return this->element_layout;
+		}
+
+		bool contains(const T &value) const
+		{
+			if (this->element_layout == tree_file::layout::eytzinger)
+			{
+				auto index = eytzinger::lower_bound(this->elements, this->count, value);
+				return index != 0 && !(value < this->elements[index]);
+			} // else, the values are sorted.
+
+			return std::binary_search(this->elements, this->elements + this->count, value);
+		}
+
+		/**
+		 * Look up count keys at once, writing whether each is present to the
+		 * matching slot of out.
+		 */
+		void contains_many(const T *keys, std::size_t count, bool *out) const
+		{
+			if (this->element_layout == tree_file::layout::eytzinger)
+			{
+				eytzinger::contains_many(this->elements, this->count, keys, count, out);
+				return;
+			} // else, search the sorted values one key at a time.
+
+			for (std::size_t index = 0; index < count; index++)
+			{
+				out[index] = std::binary_search(this->elements, this->elements + this->count, keys[index]);
+			}
+		}
+
+		/**
+		 * Call visit on every value, in order.
+		 */
+		template <typename Visitor>
+		void for_each(Visitor visit) const
+		{
+			if (this->element_layout == tree_file::layout::eytzinger)
+			{
+				for (auto index = eytzinger::first(this->count); index != 0; index = eytzinger::next(index, this->count))
+				{
+					visit(this->elements[index]);
+				}
+				return;
+			} // else, the values are already in order.
+
+			std::for_each(this->elements, this->elements + this->count, visit);
+		}
+
+	private:
+		mapped_file file;
+		const T *elements;
+		std::size_t count;
+		tree_file::layout element_layout;
+	};
+}
+
+#endif // MAPPED_TREE_H_
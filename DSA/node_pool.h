@@ -0,0 +1,283 @@
+#ifndef NODE_POOL_H_
+#define NODE_POOL_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace nwacc
+{
+	/**
+	 * A slab of fixed size slots. Slots are carved out of large blocks with
+	 * a bump pointer and recycled through a free list threaded through the
+	 * freed slots themselves. Blocks are only returned to the system when
+	 * the arena is destroyed, all at once.
+	 *
+	 * An arena is not thread safe.
+	 */
+	class node_arena
+	{
+	public:
+		node_arena(std::size_t size, std::size_t alignment) :
+			slot_size{ round_up(std::max(size, sizeof(free_slot)), std::max(alignment, alignof(free_slot))) },
+			next_block_slots{ kFirstBlockSlots }, free_list{ nullptr }, bump{ nullptr }, bump_end{ nullptr } {}
+
+		node_arena(const node_arena &rhs) = delete;
+		node_arena &operator=(const node_arena &rhs) = delete;
+
+		~node_arena()
+		{
+			for (auto *block : this->blocks)
+			{
+				::operator delete(block);
+			}
+		}
+
+		void *allocate()
+		{
+			if (this->free_list != nullptr)
+			{
+				auto *slot = this->free_list;
+				this->free_list = slot->next;
+				return slot;
+			} // else, nothing to recycle, take a fresh slot.
+
+			if (this->bump == this->bump_end)
+			{
+				this->add_block(this->next_block_slots);
+				if (this->next_block_slots < kMaxBlockSlots)
+				{
+					this->next_block_slots *= 2;
+				} // else, blocks are already as big as they get, do_nothing();
+			} // else, the current block still has room, do_nothing();
+
+			auto *slot = this->bump;
+			this->bump += this->slot_size;
+			return slot;
+		}
+
+		void deallocate(void *slot)
+		{
+			this->free_list = ::new (slot) free_slot{ this->free_list };
+		}
+
+		/**
+		 * Make sure the next count allocations come from one contiguous
+		 * block, so a bulk build lays its nodes out in order.
+		 */
+		void reserve(std::size_t count)
+		{
+			auto remaining = static_cast<std::size_t>(this->bump_end - this->bump) / this->slot_size;
+			if (remaining < count)
+			{
+				this->add_block(count);
+			} // else, the current block is big enough, do_nothing();
+		}
+
+	private:
+		struct free_slot
+		{
+			free_slot *next;
+		};
+
+		static const std::size_t kFirstBlockSlots = 64;
+		static const std::size_t kMaxBlockSlots = 65536;
+
+		std::size_t slot_size;
+		std::size_t next_block_slots;
+		free_slot *free_list;
+		char *bump;
+		char *bump_end;
+		std::vector<void *> blocks;
+
+		static std::size_t round_up(std::size_t size, std::size_t alignment)
+		{
+			return (size + alignment - 1) / alignment * alignment;
+		}
+
+		void add_block(std::size_t slots)
+		{
+			// ::operator new is aligned for any fundamental type, which covers
+			// every node we store.
+			auto *block = static_cast<char *>(::operator new(slots * this->slot_size));
+			this->blocks.push_back(block);
+			this->bump = block;
+			this->bump_end = block + slots * this->slot_size;
+		}
+	};
+
+	/**
+	 * The arenas behind a family of pool_allocators, one for each size and
+	 * alignment of object handed out. An allocator and every copy or rebind
+	 * of it share one of these, so memory allocated through one can be
+	 * freed through any other.
+	 *
+	 * Not thread safe, like the arenas.
+	 */
+	class node_pool
+	{
+	public:
+		node_pool() {}
+
+		node_pool(const node_pool &rhs) = delete;
+		node_pool &operator=(const node_pool &rhs) = delete;
+
+		/**
+		 * Return the arena for objects of this size and alignment, creating
+		 * it the first time it is asked for. Arenas never move.
+		 */
+		node_arena &arena_for(std::size_t size, std::size_t alignment)
+		{
+			for (auto &entry : this->arenas)
+			{
+				if (entry.size == size && entry.alignment == alignment)
+				{
+					return *entry.arena;
+				} // else, keep looking.
+			}
+			this->arenas.push_back({ size, alignment, std::unique_ptr<node_arena>(new node_arena(size, alignment)) });
+			return *this->arenas.back().arena;
+		}
+
+	private:
+		struct sized_arena
+		{
+			std::size_t size;
+			std::size_t alignment;
+			std::unique_ptr<node_arena> arena;
+		};
+
+		// a container only ever needs a type or two.
+		std::vector<sized_arena> arenas;
+	};
+
+	/**
+	 * A standard allocator that hands out single objects from a node_arena.
+	 * Copies and rebinds to other types share one node_pool, each type
+	 * taking objects from the pool's arena for its size, so they all
+	 * compare equal. Copying a container starts a fresh pool. Requests for
+	 * more than one object fall through to ::operator new.
+	 *
+	 * Because the pool frees everything when the last allocator sharing it
+	 * goes away, a container holding that last allocator skips the
+	 * per-node walk on destruction when its elements are trivially
+	 * destructible. While the pool is shared, with the caller or with
+	 * another container, nodes are given back one at a time as usual.
+	 */
+	template <typename T>
+	class pool_allocator
+	{
+	public:
+		using value_type = T;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		template <typename U>
+		struct rebind
+		{
+			using other = pool_allocator<U>;
+		};
+
+		pool_allocator() : pool_allocator{ std::make_shared<node_pool>() } {}
+
+		template <typename U>
+		pool_allocator(const pool_allocator<U> &rhs) : pool_allocator{ rhs.pool } {}
+
+		T *allocate(std::size_t count)
+		{
+			if (count == 1)
+			{
+				return static_cast<T *>(this->arena->allocate());
+			} // else, arrays do not fit the slots.
+
+			return static_cast<T *>(::operator new(count * sizeof(T)));
+		}
+
+		void deallocate(T *pointer, std::size_t count)
+		{
+			if (count == 1)
+			{
+				this->arena->deallocate(pointer);
+			}
+			else
+			{
+				::operator delete(pointer);
+			}
+		}
+
+		/**
+		 * Return whether no other allocator shares this one's pool, so
+		 * destroying it frees everything it handed out.
+		 */
+		bool is_last_copy() const
+		{
+			return this->pool.use_count() == 1;
+		}
+
+		/**
+		 * Lay the next count single allocations out contiguously.
+		 */
+		void reserve(std::size_t count)
+		{
+			this->arena->reserve(count);
+		}
+
+		pool_allocator select_on_container_copy_construction() const
+		{
+			return pool_allocator{};
+		}
+
+		template <typename U>
+		bool operator==(const pool_allocator<U> &rhs) const
+		{
+			return this->pool == rhs.pool;
+		}
+
+		template <typename U>
+		bool operator!=(const pool_allocator<U> &rhs) const
+		{
+			return !(*this == rhs);
+		}
+
+	private:
+		std::shared_ptr<node_pool> pool;
+		// the pool's arena for T, looked up once.
+		node_arena *arena;
+
+		explicit pool_allocator(std::shared_ptr<node_pool> pool) :
+			pool{ std::move(pool) }, arena{ &this->pool->arena_for(sizeof(T), alignof(T)) } {}
+
+		template <typename U>
+		friend class pool_allocator;
+	};
+
+	/**
+	 * Says whether destroying a container's allocator will release every
+	 * object it handed out, so the container may skip deallocating one
+	 * node at a time on destruction.
+	 */
+	template <typename Allocator>
+	struct releases_in_bulk
+	{
+		static bool on_destruction(const Allocator &)
+		{
+			return false;
+		}
+	};
+
+	template <typename T>
+	struct releases_in_bulk<pool_allocator<T>>
+	{
+		// only once no one else can still be using the pool.
+		static bool on_destruction(const pool_allocator<T> &allocator)
+		{
+			return allocator.is_last_copy();
+		}
+	};
+}
+
+#endif // NODE_POOL_H_
@@ -0,0 +1,435 @@
+#ifndef PERSISTENT_TREE_H_
+#define PERSISTENT_TREE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace nwacc
+{
+	/**
+	 * A balanced (AVL) search tree whose copies share structure. Copying
+	 * one is O(1): the copy just takes a reference to the same root. Each
+	 * node counts the links and trees that reference it, and an update
+	 * copies only the nodes on its path that are shared with some other
+	 * version, so insert and remove allocate O(log n) nodes at most and
+	 * none at all while the tree is not shared. A version never changes
+	 * once another copy can see it, so readers can hold on to a snapshot
+	 * for as long as they like while a writer carries on.
+	 *
+	 * One persistent_tree object is not thread safe, but distinct copies
+	 * may be used, copied and destroyed on different threads at once; the
+	 * reference counts are atomic.
+	 */
+	template <typename T>
+	class persistent_tree
+	{
+	private:
+		struct node
+		{
+			T element;
+			node *left;
+			node *right;
+			int height;
+			// the number of links and trees pointing at this node.
+			std::atomic<std::size_t> references;
+
+			node(const T &the_element, node *left_node, node *right_node, int the_height) :
+				element{ the_element }, left{ left_node }, right{ right_node }, height{ the_height }, references{ 1 } {}
+		};
+
+	public:
+		/**
+		 * Walks the values of one version in order. The iterator keeps the
+		 * path to the current node on a stack, since shared nodes have no
+		 * single parent. It stays valid for as long as the version it came
+		 * from (or any copy of it) is alive and unchanged.
+		 */
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() = default;
+
+			const T &operator*() const
+			{
+				return this->path.back()->element;
+			}
+
+			const T *operator->() const
+			{
+				return &this->path.back()->element;
+			}
+
+			const_iterator &operator++()
+			{
+				auto *current = this->path.back();
+				this->path.pop_back();
+				this->push_left(current->right);
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			bool operator==(const const_iterator &rhs) const
+			{
+				return this->path.empty() ? rhs.path.empty() : !rhs.path.empty() && this->path.back() == rhs.path.back();
+			}
+
+			bool operator!=(const const_iterator &rhs) const
+			{
+				return !(*this == rhs);
+			}
+
+		private:
+			// the current node is on top; below it are the ancestors we
+			// came down to the left from, which come next.
+			std::vector<const node *> path;
+
+			explicit const_iterator(const node *root)
+			{
+				this->push_left(root);
+			}
+
+			void push_left(const node *current)
+			{
+				while (current != nullptr)
+				{
+					this->path.push_back(current);
+					current = current->left;
+				}
+			}
+
+			friend class persistent_tree;
+		};
+
+		persistent_tree() : root{ nullptr }, my_size{ 0 } {}
+
+		persistent_tree(const persistent_tree &rhs) : root{ retain(rhs.root) }, my_size{ rhs.my_size } {}
+
+		persistent_tree(persistent_tree &&rhs) noexcept : root{ rhs.root }, my_size{ rhs.my_size }
+		{
+			rhs.root = nullptr;
+			rhs.my_size = 0;
+		}
+
+		persistent_tree &operator=(persistent_tree rhs) noexcept
+		{
+			std::swap(this->root, rhs.root);
+			std::swap(this->my_size, rhs.my_size);
+			return *this;
+		}
+
+		~persistent_tree()
+		{
+			release(this->root);
+		}
+
+		/**
+		 * Insert a value. Return false if it was already present, in which
+		 * case nothing is copied.
+		 */
+		bool insert(const T &value)
+		{
+			if (this->contains(value))
+			{
+				// we found a duplicate. do_nothing();
+				return false;
+			} // else, it has to go in somewhere below the root.
+
+			insert(value, this->root);
+			this->my_size++;
+			return true;
+		}
+
+		/**
+		 * Remove a value. Return false if it was not present, in which case
+		 * nothing is copied.
+		 */
+		bool remove(const T &value)
+		{
+			if (!this->contains(value))
+			{
+				// we did not find the item to remove. do_nothing();
+				return false;
+			} // else, it is somewhere below the root.
+
+			remove(value, this->root);
+			this->my_size--;
+			return true;
+		}
+
+		/**
+		 * Determine if the value is contained within this version.
+		 */
+		bool contains(const T &value) const
+		{
+			const node *current = this->root;
+			while (current != nullptr)
+			{
+				if (value < current->element)
+				{
+					current = current->left;
+				}
+				else if (current->element < value)
+				{
+					current = current->right;
+				}
+				else
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::size_t size() const
+		{
+			return this->my_size;
+		}
+
+		int height() const
+		{
+			return height(this->root);
+		}
+
+		bool is_empty() const
+		{
+			return this->root == nullptr;
+		}
+
+		/**
+		 * Determine whether the two trees are the same version, or copies of
+		 * it, by comparing their roots.
+		 */
+		bool shares_root_with(const persistent_tree &rhs) const
+		{
+			return this->root == rhs.root;
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this->root);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator();
+		}
+
+	private:
+		node *root;
+		std::size_t my_size;
+
+		static int height(const node *current)
+		{
+			return current == nullptr ? 0 : current->height;
+		}
+
+		static void update(node *current)
+		{
+			current->height = 1 + std::max(height(current->left), height(current->right));
+		}
+
+		/**
+		 * Add a reference to the node and return it.
+		 */
+		static node *retain(node *current)
+		{
+			if (current != nullptr)
+			{
+				current->references.fetch_add(1, std::memory_order_relaxed);
+			} // else, nothing to reference, do_nothing();
+			return current;
+		}
+
+		/**
+		 * Drop a reference to the node, deleting it and dropping its own
+		 * references to its children once nobody points at it. Everything
+		 * freed is unreachable from any other version, so the recursion
+		 * only goes as deep as the tree is tall.
+		 */
+		static void release(node *current)
+		{
+			if (current != nullptr && current->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				release(current->left);
+				release(current->right);
+				delete current;
+			} // else, someone else still holds it, do_nothing();
+		}
+
+		/**
+		 * Get a node we can change through a link we own. If the link holds
+		 * the only reference, no other version can see the node and it is
+		 * changed in place. Otherwise the link is pointed at a private copy
+		 * that shares the same children. The tree stays whole even if the
+		 * copy cannot be allocated.
+		 */
+		static node *take(node *&link)
+		{
+			if (link->references.load(std::memory_order_acquire) == 1)
+			{
+				return link;
+			} // else, shared with another version, copy it.
+
+			auto *copy = new node{ link->element, link->left, link->right, link->height };
+			retain(copy->left);
+			retain(copy->right);
+			release(link);
+			link = copy;
+			return copy;
+		}
+
+		/**
+		 * The functions below all work through links the caller owns, taking
+		 * each node they change on the way down.
+		 */
+
+		static void rotate_left(node *&link)
+		{
+			auto *mine = take(link);
+			auto *pivot = take(mine->right);
+			mine->right = pivot->left;
+			pivot->left = mine;
+			link = pivot;
+			update(mine);
+			update(pivot);
+		}
+
+		static void rotate_right(node *&link)
+		{
+			auto *mine = take(link);
+			auto *pivot = take(mine->left);
+			mine->left = pivot->right;
+			pivot->right = mine;
+			link = pivot;
+			update(mine);
+			update(pivot);
+		}
+
+		/**
+		 * Repair the height of a node we own and rotate it if its children
+		 * differ in height by two. Left-right and right-left cases take a
+		 * double rotation.
+		 */
+		static void balance(node *&link)
+		{
+			auto *mine = link;
+			update(mine);
+			auto difference = height(mine->left) - height(mine->right);
+			if (difference > 1)
+			{
+				if (height(mine->left->left) < height(mine->left->right))
+				{
+					rotate_left(mine->left);
+				} // else, a single rotation is enough, do_nothing();
+				rotate_right(link);
+			}
+			else if (difference < -1)
+			{
+				if (height(mine->right->right) < height(mine->right->left))
+				{
+					rotate_right(mine->right);
+				} // else, a single rotation is enough, do_nothing();
+				rotate_left(link);
+			} // else, this node is balanced, do_nothing();
+		}
+
+		/**
+		 * Add the value below the link. The value is known not to be
+		 * present.
+		 */
+		static void insert(const T &value, node *&link)
+		{
+			if (link == nullptr)
+			{
+				link = new node{ value, nullptr, nullptr, 1 };
+				return;
+			} // else, go down the side the value belongs on.
+
+			auto *mine = take(link);
+			if (value < mine->element)
+			{
+				insert(value, mine->left);
+			}
+			else
+			{
+				insert(value, mine->right);
+			}
+			balance(link);
+		}
+
+		/**
+		 * Unlink the smallest node below the link and hand it back in
+		 * minimum, owned and with no children.
+		 */
+		static void remove_min(node *&link, node *&minimum)
+		{
+			auto *mine = take(link);
+			if (mine->left == nullptr)
+			{
+				minimum = mine;
+				link = mine->right;
+				mine->right = nullptr;
+				return;
+			} // else, keep going left.
+
+			remove_min(mine->left, minimum);
+			balance(link);
+		}
+
+		/**
+		 * Remove the value from below the link. It is known to be present.
+		 * A node with two children is replaced by the smallest node of its
+		 * right subtree.
+		 */
+		static void remove(const T &value, node *&link)
+		{
+			auto *mine = take(link);
+			if (value < mine->element)
+			{
+				remove(value, mine->left);
+				balance(link);
+				return;
+			}
+			else if (mine->element < value)
+			{
+				remove(value, mine->right);
+				balance(link);
+				return;
+			}
+			else if (mine->left == nullptr || mine->right == nullptr)
+			{
+				link = (mine->left != nullptr) ? mine->left : mine->right;
+				mine->left = mine->right = nullptr;
+				release(mine);
+				return;
+			} // else, we have two children!
+
+			node *minimum = nullptr;
+			remove_min(mine->right, minimum);
+			minimum->left = mine->left;
+			minimum->right = mine->right;
+			mine->left = mine->right = nullptr;
+			link = minimum;
+			release(mine);
+			balance(link);
+		}
+	};
+}
+
+#endif // PERSISTENT_TREE_H_
@@ -2,13 +2,69 @@
 #define TREE_H_
 
 #include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "buffered_writer.h"
+#include "flat_tree.h"
+#include "node_pool.h"
+#include "tree_file.h"
+#include "tree_stats.h"
 
 namespace nwacc
 {
-	template<typename T>
-	class tree
+	/**
+	 * Balance policy for a plain binary search tree. Nodes are linked
+	 * wherever they land, so sorted input degenerates into a list.
+	 */
+	struct unbalanced
+	{
+		static const bool kSelfBalancing = false;
+	};
+
+	/**
+	 * Balance policy for an AVL tree. After every insert and remove the
+	 * heights along the parent chain are repaired with rotations, so the
+	 * height never exceeds 1.44 log(n) and every operation is O(log n).
+	 */
+	struct avl
+	{
+		static const bool kSelfBalancing = true;
+	};
+
+	/**
+	 * A way into a tree's nodes for tests, such as to link a shape that no
+	 * order of inserts builds quickly. Only declared here; a test defines
+	 * it for itself.
+	 */
+	template <typename Tree>
+	struct tree_access;
+
+	/**
+	 * Nodes are obtained from the Allocator rebound to the node type; use
+	 * nwacc::pool_allocator to carve them out of contiguous blocks.
+	 *
+	 * Values are ordered by Compare. If Compare declares is_transparent,
+	 * as std::less<> does, lookups also accept any key type it can compare
+	 * against T, so no temporary T has to be built to search with.
+	 *
+	 * Build with NWACC_TREE_STATS defined to have every tree count its
+	 * operations, comparisons and allocations and sample their latency;
+	 * see stats.
+	 */
+	template<typename T, typename Balance = unbalanced, typename Allocator = std::allocator<T>, typename Compare = std::less<T>>
+	class tree : private tree_stats_recorder
 	{
 	private:
 		struct node
@@ -17,38 +73,109 @@ namespace nwacc
 			node *left;
 			node *right;
 			node *parent;
+			// only maintained when Balance is self balancing.
+			int height;
+			// the number of nodes in the subtree rooted here.
+			std::size_t size;
 
-			node(const T &the_element, node *left_node, node *right_node, node *parent_node) :
-				element{ the_element }, left{ left_node }, right{ right_node }, parent{ parent_node } {}
-
-			node(T &&the_element, node *left_node, node *right_node, node parent_node) :
-				element{ std::move(the_element) }, left{ left_node }, right{ right_node }, parent{ parent_node } {}
+			// build the element in place from whatever arguments T takes.
+			template <typename... Args>
+			node(node *parent_node, Args &&... args) :
+				element{ std::forward<Args>(args)... }, left{ nullptr }, right{ nullptr }, parent{ parent_node }, height{ 1 }, size{ 1 } {}
 		};
 
 	public:
 		tree() : root { nullptr } {}
 
-		tree(const tree &rhs) : root { nullptr }
+		explicit tree(const Allocator &allocator) : root { nullptr }, allocator { allocator } {}
+
+		explicit tree(const Compare &compare, const Allocator &allocator = Allocator()) :
+			root { nullptr }, allocator { allocator }, compare { compare } {}
+
+		tree(const tree &rhs) : tree_stats_recorder{}, root { nullptr },
+			allocator { node_traits::select_on_container_copy_construction(rhs.allocator) }, compare { rhs.compare }
 		{
-			this->root = this->clone(rhs.root);
+			this->root = this->clone(rhs.root, nullptr);
 		}
 
-		tree(tree &&rhs) noexcept : root { rhs.root }
+		tree(tree &&rhs) noexcept : root { rhs.root }, allocator { rhs.allocator }, compare { rhs.compare }
 		{
 			rhs.root = nullptr;
 		}
 
 		~tree()
 		{
+			if (std::is_trivially_destructible<T>::value && releases_in_bulk<node_allocator>::on_destruction(this->allocator))
+			{
+				// the allocator gives back every node at once when it goes away.
+				return;
+			} // else, every node has to be destroyed on its own.
+
 			this->empty(this->root);
 		}
 
 		/**
-		 * Insert a value at the current node.
+		 * Copy and swap. The copy is made with rhs's allocator if the
+		 * allocator propagates on copy assignment and with this one's
+		 * otherwise, and the old nodes leave with the allocator that made
+		 * them.
+		 */
+		tree &operator=(const tree &rhs)
+		{
+			if (this != &rhs)
+			{
+				tree copy{ rhs.compare, Allocator(node_traits::propagate_on_container_copy_assignment::value ? rhs.allocator : this->allocator) };
+				copy.root = copy.clone(rhs.root, nullptr);
+				this->swap_contents(copy);
+			} // else, self assignment, do_nothing();
+			return *this;
+		}
+
+		/**
+		 * Take over rhs's nodes, along with its allocator if the allocator
+		 * propagates on move assignment. Allocators that stay put and
+		 * compare unequal cannot free each other's nodes, so then the
+		 * values are copied instead.
+		 */
+		tree &operator=(tree &&rhs) noexcept(node_traits::propagate_on_container_move_assignment::value || node_traits::is_always_equal::value)
+		{
+			if (this != &rhs)
+			{
+				this->move_assign(rhs, std::integral_constant<bool,
+					node_traits::propagate_on_container_move_assignment::value || node_traits::is_always_equal::value>{});
+			} // else, self assignment, do_nothing();
+			return *this;
+		}
+
+		/**
+		 * Build a height balanced tree from a sorted range in O(n), instead
+		 * of O(n log n) (or O(n^2) unbalanced) for inserting one at a time.
+		 * Repeated values are kept once. With an allocator that can reserve,
+		 * such as pool_allocator, the nodes come from one contiguous block
+		 * in sorted order.
+		 */
+		template <typename ForwardIterator>
+		static tree from_sorted(ForwardIterator first, ForwardIterator last,
+			const Allocator &allocator = Allocator(), const Compare &compare = Compare())
+		{
+			tree result{ compare, allocator };
+			auto count = result.count_unique(first, last);
+			reserve_nodes(result.allocator, count, 0);
+			result.root = result.build(first, last, count, nullptr);
+			return result;
+		}
+
+		/**
+		 * Build a height balanced tree from values in any order by sorting a
+		 * copy of them first and then loading that, in O(n log n).
 		 */
-		void insert(const T &value)
+		template <typename InputIterator>
+		static tree from_unsorted(InputIterator first, InputIterator last,
+			const Allocator &allocator = Allocator(), const Compare &compare = Compare())
 		{
-			this->insert(value, this->root, nullptr);
+			std::vector<T> values(first, last);
+			std::sort(values.begin(), values.end(), compare);
+			return from_sorted(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()), allocator, compare);
 		}
 
 		/**
@@ -59,13 +186,182 @@ namespace nwacc
 			this->remove(value, this->root);
 		}
 
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		void remove(const Key &key)
+		{
+			this->remove(key, this->root);
+		}
+
+		/**
+		 * Return the number of values in the tree.
+		 */
+		std::size_t size() const
+		{
+			return subtree_size(this->root);
+		}
+
+		/**
+		 * Return the number of levels in the tree. An empty tree has a
+		 * height of zero. This is O(1) for self balancing trees and a full
+		 * walk otherwise.
+		 */
+		int height() const
+		{
+			if (Balance::kSelfBalancing)
+			{
+				return this->height(this->root);
+			} // else, heights are not maintained, measure the tree.
+
+			return this->measure_height();
+		}
+
+		/**
+		 * Take a snapshot of the counters kept under NWACC_TREE_STATS along
+		 * with the size, height and depth histogram of the tree, which are
+		 * measured with a full walk. Pass it to dump to export it.
+		 */
+		tree_stats stats() const
+		{
+			tree_stats result{};
+			this->collect(result);
+			this->traverse(order::pre, [&result](const node *, int depth) {
+				if (result.depth_histogram.size() < static_cast<std::size_t>(depth))
+				{
+					result.depth_histogram.resize(depth);
+				} // else, this level has been seen, do_nothing();
+
+				result.depth_histogram[depth - 1]++;
+			});
+			result.size = this->size();
+			result.height = static_cast<int>(result.depth_histogram.size());
+			return result;
+		}
+
 		/**
 		 * Determine if the reference value is contained within
 		 * the current node and return true or false.
 		 */
 		bool contains(const T &value) const
 		{
-			return this->contains(value, this->root);
+			return this->find_node(value) != nullptr;
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		bool contains(const Key &key) const
+		{
+			return this->find_node(key) != nullptr;
+		}
+
+		/**
+		 * Determine for each of count keys whether it is contained in the
+		 * tree, writing the answers to the matching slots of out. A group of
+		 * lookups walks down together one level at a time, prefetching the
+		 * next node of each, so their cache misses overlap.
+		 */
+		void contains_many(const T *keys, std::size_t count, bool *out) const
+		{
+			const std::size_t kLanes = 8;
+			std::size_t comparisons = 0;
+			auto counted = [&comparisons](bool result) {
+				comparisons++;
+				return result;
+			};
+			for (std::size_t done = 0; done < count; done += kLanes)
+			{
+				const auto lanes = std::min(kLanes, count - done);
+				const node *current[kLanes];
+				for (std::size_t lane = 0; lane < lanes; lane++)
+				{
+					current[lane] = this->root;
+					out[done + lane] = false;
+				}
+
+				auto active = lanes;
+				while (active != 0)
+				{
+					active = 0;
+					for (std::size_t lane = 0; lane < lanes; lane++)
+					{
+						auto *next = current[lane];
+						if (next == nullptr)
+						{
+							continue;
+						} // else, this lookup is still going.
+
+						const auto &key = keys[done + lane];
+						if (counted(this->compare(key, next->element)))
+						{
+							next = next->left;
+						}
+						else if (counted(this->compare(next->element, key)))
+						{
+							next = next->right;
+						}
+						else
+						{
+							out[done + lane] = true;
+							next = nullptr;
+						}
+
+						if (next != nullptr)
+						{
+							eytzinger::prefetch(next);
+							active++;
+						} // else, this lookup is finished, do_nothing();
+						current[lane] = next;
+					}
+				}
+			}
+			this->record_batch(tree_operation::lookup, count, comparisons);
+		}
+
+		/**
+		 * Take an immutable, cache friendly snapshot of the tree for read
+		 * heavy work. Later changes to the tree do not show up in the
+		 * snapshot; freeze again to rebuild it.
+		 */
+		flat_tree<T> freeze() const
+		{
+			flat_tree<T> snapshot;
+			this->freeze(snapshot);
+			return snapshot;
+		}
+
+		/**
+		 * Rebuild an existing snapshot from the tree, reusing its storage.
+		 * The snapshot searches with operator<, so this is only available
+		 * while the tree is ordered the same way.
+		 */
+		void freeze(flat_tree<T> &snapshot) const
+		{
+			static_assert(kOrdersByLess, "flat_tree orders by operator<, freeze needs a tree that does too");
+
+			snapshot.assign(this->begin(), this->end());
+		}
+
+		/**
+		 * Write the values to path in the binary tree_file format, either in
+		 * sorted order or laid out the way flat_tree searches, so that
+		 * mapped_tree can query the file in place. Only trivially copyable
+		 * values can be saved. Throws std::runtime_error if the file cannot
+		 * be written.
+		 */
+		void save(const std::string &path, tree_file::layout element_layout = tree_file::layout::sorted) const
+		{
+			static_assert(kOrdersByLess, "saved files are searched with operator<, save needs a tree ordered by it");
+
+			tree_file::write<T>(path, this->begin(), this->size(), element_layout);
+		}
+
+		/**
+		 * Read a file written by save into a new tree, building it with
+		 * from_sorted in O(n). Throws std::runtime_error if the file is
+		 * missing, truncated or holds a different type.
+		 */
+		static tree load(const std::string &path, const Allocator &allocator = Allocator())
+		{
+			auto values = tree_file::read_sorted<T>(path);
+			return from_sorted(values.begin(), values.end(), allocator);
 		}
 
 		/**
@@ -77,20 +373,49 @@ namespace nwacc
 			return this->root == nullptr;
 		}
 
+		/**
+		 * The orders a whole tree can be walked in.
+		 */
+		enum class order { pre, in, post };
+
+		/**
+		 * Export every value as text through a sink, each followed by the
+		 * separator. The text is formatted into a buffered_writer, so the
+		 * sink gets a few large writes instead of one per value, and the
+		 * walk streams: only the buffer is held in memory however big the
+		 * tree is. A sink is any callable taking (const char *, size_t),
+		 * such as ostream_sink or iterator_sink; it is returned once
+		 * everything has been flushed to it. To export part of the tree,
+		 * pass a range of its iterators to write_range.
+		 */
+		template <typename Sink>
+		Sink write(Sink sink, order which = order::in, char separator = '\n') const
+		{
+			buffered_writer<Sink> writer{ std::move(sink) };
+			this->traverse(which, [&writer, separator](const node *current, int) {
+				writer.write_value(current->element);
+				writer.put(separator);
+			});
+			writer.flush();
+			return std::move(writer.sink());
+		}
+
 		/**
 		 * Overload the print operator.
 		 * If the current tree is empty, print "Empty Tree"
 		 * Otherwise, print the current tree in no order.
 		 */
-		void print(std::ostream &out = std::cout)
+		void print(std::ostream &out = std::cout) const
 		{
 			if (this->is_empty())
 			{
-				out << "Empty Tree" << std::endl;
+				out << "Empty Tree\n";
 			}
 			else
 			{
-				this->print(this->root, out);
+				this->traverse(order::pre, [&out](const node *current, int) {
+					out << current->element << '\n';
+				});
 			}
 		}
 
@@ -99,15 +424,17 @@ namespace nwacc
 		 * If the current tree is empty, print "Empty Tree"
 		 * Otherwise, start at the "first" value in the tree.
 		 */
-		void print_in_order(std::ostream &out = std::cout)
+		void print_in_order(std::ostream &out = std::cout) const
 		{
 			if (this->is_empty())
 			{
-				out << "Empty Tree" << std::endl;
+				out << "Empty Tree\n";
 			}
 			else
 			{
-				this->print_in_order(this->root, out);
+				this->traverse(order::in, [&out](const node *current, int) {
+					out << current->element << '\n';
+				});
 			}
 		}
 
@@ -116,62 +443,58 @@ namespace nwacc
 		 * If the current tree is empty, print "Empty Tree"
 		 * Otherwise, start at the last value in the tree.
 		 */
-		void print_post_order(std::ostream &out = std::cout)
+		void print_post_order(std::ostream &out = std::cout) const
 		{
 			if (this->is_empty())
 			{
-				out << "Empty Tree" << std::endl;
-			}
-			else
-			{
-				this->print_post_order(this->root, out);
-			}
-		}
-
-		/**
-		* Find the first node in the tree.
-		* If the current value stored within the current node is a null pointer,
-		* then return nullptr.
-		* Else return the current value stored within the current node.
-		*/
-		node *begin(tree &value) const
-		{
-			if (value.root == nullptr)
-			{
-				return nullptr;
+				out << "Empty Tree\n";
 			}
 			else
 			{
-				return find_min(value);
+				this->traverse(order::post, [&out](const node *current, int) {
+					out << current->element << '\n';
+				});
 			}
 		}
 
-		class iterator
+		class const_iterator
 		{
 		public:
-			iterator() : current{ nullptr } {}
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() : owner{ nullptr }, current{ nullptr } {}
 
 			/**
 			 * Overload the pointer operator.
 			 */
-			T &operator*()
+			const T &operator*() const
 			{
 				return this->retrieve();
 			}
 
+			const T *operator->() const
+			{
+				return &this->retrieve();
+			}
+
 			/**
-			 * Overload the ++ prefix operator.
+			 * Move to the next value in order. Climbing back up through the
+			 * parent links makes a full scan O(1) per step on average.
 			 */
-			iterator &operator++()
+			const_iterator &operator++()
 			{
-				this->current = this->current->right;
+				this->current = find_next_node(this->current);
 				return *this;
 			}
 
 			/**
-			* This is the ++ postfix operator.
-			*/
-			iterator operator++(int)
+			 * This is the postfix operator.
+			 */
+			const_iterator operator++(int)
 			{
 				auto old = *this;
 				++(*this);
@@ -179,18 +502,21 @@ namespace nwacc
 			}
 
 			/**
-			 * Overload the prefix -- operator.
+			 * Move to the previous value in order. Stepping back from end()
+			 * lands on the largest value.
 			 */
-			iterator &operator--()
+			const_iterator &operator--()
 			{
-				this->current = this->current->left;
+				this->current = (this->current == nullptr)
+					? find_max(this->owner->root)
+					: find_previous_node(this->current);
 				return *this;
 			}
 
 			/**
-			 * Overload the postfix -- operator.
+			 * This is the postfix operator.
 			 */
-			iterator operator--(int)
+			const_iterator operator--(int)
 			{
 				auto old = *this;
 				--(*this);
@@ -198,10 +524,10 @@ namespace nwacc
 			}
 
 			/**
-			* Return the comparison of the current node vs the rhs
-			* of the current node are equal to each other.
-			*/
-			bool operator== (const iterator &rhs)
+			 * Return the comparison of the current node vs the rhs
+			 * of the current node are equal to each other.
+			 */
+			bool operator== (const const_iterator &rhs) const
 			{
 				return this->current == rhs.current;
 			}
@@ -210,307 +536,1626 @@ namespace nwacc
 			 * Return the comparison of the current node vs the rhs
 			 * node is not equal to each other.
 			 */
-			bool operator!= (const iterator &rhs)
+			bool operator!= (const const_iterator &rhs) const
 			{
 				return !(*this == rhs);
 			}
 
-		private:
+		protected:
+			const tree *owner;
 			node *current;
 
-			T &retrieve()
+			/**
+			 * Retrieve the data that is stored in the current node.
+			 */
+			T &retrieve() const
 			{
-				return this->current->data;
+				return this->current->element;
 			}
 
-			iterator(node *current) : current{ current } {}
+			const_iterator(const tree *owner, node *current) : owner{ owner }, current{ current } {}
 
-			friend class tree<T>;
+			friend class tree;
 		};
 
-		class const_iterator
+		// iterator IS-A const_iterator that also hands out mutable
+		// references. Changing a value in a way that changes its order
+		// corrupts the tree.
+		class iterator : public const_iterator
 		{
 		public:
+			using pointer = T *;
+			using reference = T &;
 
-			const_iterator() : current{ nullptr } {}
+			iterator() {}
+
+			T &operator*()
+			{
+				return const_iterator::retrieve();
+			}
 
-			/**
-			 * Overload the pointer operator.
-			 */
 			const T &operator*() const
 			{
-				return this->retrieve();
+				return const_iterator::operator*();
 			}
 
-			// prefix ++ operator
-			const_iterator &operator++()
+			T *operator->()
+			{
+				return &const_iterator::retrieve();
+			}
+
+			iterator &operator++()
 			{
-				this->current = this->current->right;
+				this->current = find_next_node(this->current);
 				return *this;
 			}
 
-			/**
-			 * This is the postfix operator.
-			 */
-			const_iterator operator++(int)
+			iterator operator++(int)
 			{
 				auto old = *this;
 				++(*this);
 				return old;
 			}
 
-			/**
-			 * This is the prefix operator.
-			 */
-			const_iterator &operator--()
+			iterator &operator--()
 			{
-				this->current = this->current->left;
+				const_iterator::operator--();
 				return *this;
 			}
 
-			/**
-			 * This is the postfix operator.
-			 */
-			const_iterator operator--(int)
+			iterator operator--(int)
 			{
 				auto old = *this;
 				--(*this);
 				return old;
 			}
 
-			/**
-			 * Return the comparison of the current node vs the rhs
-			 * of the current node are equal to each other.
-			 */
-			bool operator== (const const_iterator &rhs) const
-			{
-				return this->current == rhs.current;
-			}
+		protected:
+			iterator(const tree *owner, node *current) : const_iterator{ owner, current } {}
 
-			/**
-			 * Return the comparison of the current node vs the rhs
-			 * node is not equal to each other.
-			 */
-			bool operator!= (const const_iterator &rhs) const
-			{
-				return !(*this == rhs);
-			}
+			friend class tree;
+		};
 
-		protected:
-			node *current;
+		using reverse_iterator = std::reverse_iterator<iterator>;
+		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-			/**
-			 * Retrieve the data that is stored in the current node.
-			 */
-			T &retrieve() const
-			{
-				return this->current->data;
-			}
+		iterator begin()
+		{
+			return iterator(this, find_min(this->root));
+		}
 
-			const_iterator(node *current) : current{ current } {}
+		const_iterator begin() const
+		{
+			return const_iterator(this, find_min(this->root));
+		}
 
-			friend class tree<T>;
-		};
+		iterator end()
+		{
+			return iterator(this, nullptr);
+		}
 
-	private:
+		const_iterator end() const
+		{
+			return const_iterator(this, nullptr);
+		}
 
-		node *root;
+		const_iterator cbegin() const
+		{
+			return this->begin();
+		}
 
-		/**
-		 * Make a clone of the current node for manipulation and restructuring
-		 * of the current tree set.
-		 */
-		node *clone(node *current) const
+		const_iterator cend() const
 		{
-			if (current == nullptr)
-			{
-				return nullptr;
-			}
-			else
-			{
-				return new node{ current->element, this->clone(current->left), this->clone(current->right), this->clone(current->parent) };
-			}
+			return this->end();
 		}
 
-		/**
-		 * Print the tree set in before it has been balanced.
-		 * Also known as "Pre-Order".
-		 */
-		void print(node *current, std::ostream &out) const
+		reverse_iterator rbegin()
 		{
-			if (current != nullptr)
-			{
-				// order is pre-order
-				out << current->element << std::endl;
-				this->print(current->left, out);
-				this->print(current->right, out);
-				//this->print(current->parent, out);
-			}
+			return reverse_iterator(this->end());
 		}
 
-		void print_post_order(node *current, std::ostream &out) const
+		const_reverse_iterator rbegin() const
 		{
-			if (current != nullptr)
-			{
-				// order is post-order
-				this->print_post_order(current->left, out);
-				this->print_post_order(current->right, out);
-				//this->print(current->parent, out);
-				out << current->element << std::endl;
-			}
+			return const_reverse_iterator(this->end());
 		}
 
-		void print_in_order(node *current, std::ostream &out) const
+		reverse_iterator rend()
 		{
-			if (current != nullptr)
-			{
-				// order is in-order.
-				this->print_in_order(current->left, out);
-				out << current->element << std::endl;
-				this->print_in_order(current->right, out);
-				//this->print(current->parent, out);
-			}
+			return reverse_iterator(this->begin());
+		}
+
+		const_reverse_iterator rend() const
+		{
+			return const_reverse_iterator(this->begin());
+		}
+
+		const_reverse_iterator crbegin() const
+		{
+			return this->rbegin();
+		}
+
+		const_reverse_iterator crend() const
+		{
+			return this->rend();
 		}
 
 		/**
-		 * If the current node is empty, then delete the current node
-		 * from the tree.
+		 * Insert a copy of the value. Return an iterator to the value in the
+		 * tree and whether it was inserted; if an equal value was already
+		 * there, nothing changes and the iterator points at that one.
 		 */
-		void empty(node *&current)
+		std::pair<iterator, bool> insert(const T &value)
 		{
-			if (current != nullptr)
-			{
-				this->empty(current->left);
-				this->empty(current->right);
-				delete current;
-			}
-			current = nullptr;
+			return this->insert_unique(value);
 		}
 
 		/**
-		 * Determine if the reference value is currently contained within
-		 * the current node and return either true or false.
+		 * Insert the value by moving it into the new node.
 		 */
-		bool contains(const T &value, node *current) const
+		std::pair<iterator, bool> insert(T &&value)
 		{
-			while (current != nullptr)
-			{
-				if (value < current->element)
-				{
-					current = current->left;
-				}
-				else if (current->element < value)
-				{
-					current = current->right;
-				}
-				else
-				{
-					return true;
-				}
-			}
-			return false;
+			return this->insert_unique(std::move(value));
 		}
 
 		/**
-		 * Insert a value at the current node. If the current node is equal to
-		 * a null pointer. Then create a new node at the current location.
-		 * If the current node is less than the right node, insert the value
-		 * at the left node.
-		 * If the current node is greater than the right node, insert the value
-		 * at the right node.
-		 * If a duplicate value is found. Do nothing.
+		 * Construct a value in place from args and insert it. The node has
+		 * to be built before we know where it goes, so if an equal value is
+		 * already present the new one is built and thrown away; use
+		 * try_emplace to avoid that.
 		 */
-		iterator insert(const T &value, node *&current, node *parent)
+		template <typename... Args>
+		std::pair<iterator, bool> emplace(Args &&... args)
 		{
-			if (current == nullptr)
+			auto scope = this->record(tree_operation::insert);
+			auto *current = this->create_node(nullptr, std::forward<Args>(args)...);
+			node *parent;
+			auto **link = this->find_slot(current->element, parent);
+			if (link == nullptr)
 			{
-				if (parent == nullptr)
-				{
-					current = new node{ value, nullptr, nullptr, nullptr };
-					root = current;
-					return iterator( current );
-				}
+				this->destroy_node(current);
+				return { iterator(this, parent), false };
+			} // else, there is a free spot for it.
+
+			current->parent = parent;
+			this->link_node(link, current);
+			return { iterator(this, current), true };
+		}
+
+		/**
+		 * Look up key and, only if no equal value is present, construct a
+		 * value in place from args. The value built must compare equal to
+		 * key. Nothing is constructed, copied or allocated for a duplicate.
+		 */
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const T &key, Args &&... args)
+		{
+			return this->try_emplace_key(key, std::forward<Args>(args)...);
+		}
+
+		template <typename Key, typename... Args, typename C = Compare, typename = typename C::is_transparent>
+		std::pair<iterator, bool> try_emplace(const Key &key, Args &&... args)
+		{
+			return this->try_emplace_key(key, std::forward<Args>(args)...);
+		}
+
+		/**
+		 * Return an iterator to the value, or end() if it is not in the tree.
+		 */
+		iterator find(const T &value)
+		{
+			return iterator(this, this->find_node(value));
+		}
+
+		const_iterator find(const T &value) const
+		{
+			return const_iterator(this, this->find_node(value));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator find(const Key &key)
+		{
+			return iterator(this, this->find_node(key));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator find(const Key &key) const
+		{
+			return const_iterator(this, this->find_node(key));
+		}
+
+		/**
+		 * Return an iterator to the first value that is not less than the
+		 * given value, or end() if there is none.
+		 */
+		iterator lower_bound(const T &value)
+		{
+			return iterator(this, this->lower_bound_node(value));
+		}
+
+		const_iterator lower_bound(const T &value) const
+		{
+			return const_iterator(this, this->lower_bound_node(value));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator lower_bound(const Key &key)
+		{
+			return iterator(this, this->lower_bound_node(key));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator lower_bound(const Key &key) const
+		{
+			return const_iterator(this, this->lower_bound_node(key));
+		}
+
+		/**
+		 * Return an iterator to the first value that is greater than the
+		 * given value, or end() if there is none.
+		 */
+		iterator upper_bound(const T &value)
+		{
+			return iterator(this, this->upper_bound_node(value));
+		}
+
+		const_iterator upper_bound(const T &value) const
+		{
+			return const_iterator(this, this->upper_bound_node(value));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator upper_bound(const Key &key)
+		{
+			return iterator(this, this->upper_bound_node(key));
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator upper_bound(const Key &key) const
+		{
+			return const_iterator(this, this->upper_bound_node(key));
+		}
+
+		/**
+		 * Return the number of values in the tree that are less than the
+		 * given value. Each step right skips the whole left subtree and the
+		 * current node.
+		 */
+		std::size_t rank(const T &value) const
+		{
+			std::size_t result = 0;
+			auto *current = this->root;
+			while (current != nullptr)
+			{
+				if (this->compare(current->element, value))
+				{
+					result += subtree_size(current->left) + 1;
+					current = current->right;
+				}
+				else
+				{
+					current = current->left;
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * Return an iterator to the k-th smallest value, counting from zero,
+		 * or end() if the tree holds k or fewer values.
+		 */
+		iterator select(std::size_t k)
+		{
+			return iterator(this, this->select_node(k));
+		}
+
+		const_iterator select(std::size_t k) const
+		{
+			return const_iterator(this, this->select_node(k));
+		}
+
+		/**
+		 * Return how many values lie in [low, high).
+		 */
+		std::size_t count_range(const T &low, const T &high) const
+		{
+			if (!this->compare(low, high))
+			{
+				return 0;
+			} // else, the range is not empty, do_nothing();
+
+			return this->rank(high) - this->rank(low);
+		}
+
+		/**
+		 * Call visit on every value in [low, high), in order. This costs
+		 * O(log n) to find the start plus O(1) per value visited.
+		 */
+		template <typename Visitor>
+		void for_each_in_range(const T &low, const T &high, Visitor visit) const
+		{
+			for (auto *current = this->lower_bound_node(low);
+				current != nullptr && this->compare(current->element, high);
+				current = find_next_node(current))
+			{
+				visit(current->element);
+			}
+		}
+
+		/**
+		 * Add every value of other to this tree. The set operations below
+		 * work by splitting and joining subtrees rather than inserting one
+		 * value at a time, so merging a tree of m values into one of n
+		 * values costs O(m log(n / m + 1)). Independent halves of the work
+		 * run in parallel on up to threads threads once they are large
+		 * enough to pay for it. They need a self balancing tree.
+		 *
+		 * The nodes of other are moved across when the two allocators
+		 * compare equal; otherwise they are copied into this tree first.
+		 */
+		void union_with(tree &&other, unsigned threads = std::thread::hardware_concurrency())
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			if (&other == this)
+			{
+				return;
+			}
+			else if (!(this->allocator == other.allocator))
+			{
+				this->union_with(static_cast<const tree &>(other), threads);
+				return;
+			} // else, the nodes can change hands.
+
+			auto *second = other.root;
+			other.root = nullptr;
+			node_chain discarded;
+			this->root = this->unite(this->root, second, threads, discarded);
+			this->finish(discarded);
+		}
+
+		void union_with(const tree &other, unsigned threads = std::thread::hardware_concurrency())
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			if (&other == this)
+			{
+				return;
+			} // else, copy the nodes over with our allocator.
+
+			tree copy{ this->compare };
+			copy.allocator = this->allocator;
+			copy.root = copy.clone(other.root, nullptr);
+			this->union_with(std::move(copy), threads);
+		}
+
+		/**
+		 * Keep only the values that are also in other.
+		 */
+		void intersect(const tree &other, unsigned threads = std::thread::hardware_concurrency())
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			if (&other == this)
+			{
+				return;
+			} // else, other is only read, never relinked.
+
+			node_chain discarded;
+			this->root = this->intersection(this->root, other.root, threads, discarded);
+			this->finish(discarded);
+		}
+
+		/**
+		 * Remove every value that is also in other.
+		 */
+		void difference(const tree &other, unsigned threads = std::thread::hardware_concurrency())
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			if (&other == this)
+			{
+				this->empty(this->root);
+				return;
+			} // else, other is only read, never relinked.
+
+			node_chain discarded;
+			this->root = this->subtract(this->root, other.root, threads, discarded);
+			this->finish(discarded);
+		}
+
+		/**
+		 * Move every value that is not less than key into a new tree and
+		 * return it, in O(log n). The new tree shares this tree's allocator.
+		 */
+		tree split(const T &key)
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			tree result{ this->compare };
+			result.allocator = this->allocator;
+			node *left;
+			node *right;
+			auto *match = this->split_at(this->root, key, left, right);
+			if (match != nullptr)
+			{
+				right = join_trees(nullptr, match, right);
+			} // else, key is not in the tree, do_nothing();
+
+			this->root = detach(left);
+			result.root = detach(right);
+			return result;
+		}
+
+		/**
+		 * Append every value of other, which must all be greater than every
+		 * value in this tree, in O(log n). Throws std::invalid_argument if
+		 * the two trees overlap.
+		 */
+		void join(tree &&other)
+		{
+			static_assert(Balance::kSelfBalancing, "set operations need a self balancing tree");
+			if (other.root == nullptr || &other == this)
+			{
+				return;
+			}
+			else if (this->root != nullptr && !this->compare(find_max(this->root)->element, find_min(other.root)->element))
+			{
+				throw std::invalid_argument("Joined tree must hold only greater values");
+			}
+			else if (!(this->allocator == other.allocator))
+			{
+				tree copy{ this->compare };
+				copy.allocator = this->allocator;
+				copy.root = copy.clone(other.root, nullptr);
+				this->join(std::move(copy));
+				return;
+			} // else, the nodes can change hands.
+
+			this->root = detach(concatenate(this->root, other.root));
+			other.root = nullptr;
+		}
+
+	private:
+		template <typename Tree>
+		friend struct tree_access;
+
+		using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+		using node_traits = std::allocator_traits<node_allocator>;
+
+		static const bool kOrdersByLess = std::is_same<Compare, std::less<T>>::value || std::is_same<Compare, std::less<>>::value;
+
+		node *root;
+		node_allocator allocator;
+		Compare compare;
+
+		void swap_contents(tree &rhs)
+		{
+			std::swap(this->root, rhs.root);
+			std::swap(this->allocator, rhs.allocator);
+			std::swap(this->compare, rhs.compare);
+		}
+
+		// the nodes can always change hands.
+		void move_assign(tree &rhs, std::true_type)
+		{
+			// old keeps this tree's nodes and allocator until it goes away.
+			tree old{ std::move(*this) };
+			this->root = rhs.root;
+			rhs.root = nullptr;
+			if (node_traits::propagate_on_container_move_assignment::value)
+			{
+				this->allocator = rhs.allocator;
+			} // else, the allocators are always equal, do_nothing();
+			this->compare = rhs.compare;
+		}
+
+		// the nodes can only change hands if the allocators are equal.
+		void move_assign(tree &rhs, std::false_type)
+		{
+			if (this->allocator == rhs.allocator)
+			{
+				this->move_assign(rhs, std::true_type{});
+				return;
+			} // else, copy into nodes of this tree's own.
+
+			tree copy{ rhs.compare, Allocator(this->allocator) };
+			copy.root = copy.clone(rhs.root, nullptr);
+			this->swap_contents(copy);
+		}
+
+		/**
+		 * Allocate a leaf node under the given parent and construct its
+		 * element from args.
+		 */
+		template <typename... Args>
+		node *create_node(node *parent, Args &&... args)
+		{
+			auto *current = node_traits::allocate(this->allocator, 1);
+			this->record_allocation();
+			try
+			{
+				node_traits::construct(this->allocator, current, parent, std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				node_traits::deallocate(this->allocator, current, 1);
+				this->record_deallocation();
+				throw;
+			}
+			return current;
+		}
+
+		void destroy_node(node *current)
+		{
+			node_traits::destroy(this->allocator, current);
+			node_traits::deallocate(this->allocator, current, 1);
+			this->record_deallocation();
+		}
+
+		/**
+		 * Make a clone of the current node for manipulation and restructuring
+		 * of the current tree set. The copy is linked under the given parent.
+		 * Both trees are walked together through the parent links: go down
+		 * into any child that has not been copied yet, otherwise climb back
+		 * up, so no stack is needed however deep the tree is.
+		 */
+		node *clone(node *current, node *parent)
+		{
+			if (current == nullptr)
+			{
+				return nullptr;
+			} // else, there is something to copy.
+
+			auto *copy = this->copy_node(current, parent);
+			auto *source = current;
+			auto *target = copy;
+			try
+			{
+				while (true)
+				{
+					if (source->left != nullptr && target->left == nullptr)
+					{
+						target->left = this->copy_node(source->left, target);
+						source = source->left;
+						target = target->left;
+					}
+					else if (source->right != nullptr && target->right == nullptr)
+					{
+						target->right = this->copy_node(source->right, target);
+						source = source->right;
+						target = target->right;
+					}
+					else if (source != current)
+					{
+						source = source->parent;
+						target = target->parent;
+					}
+					else
+					{
+						return copy;
+					}
+				}
+			}
+			catch (...)
+			{
+				this->empty(copy);
+				throw;
+			}
+		}
+
+		/**
+		 * Copy a single node, without its children, under the given parent.
+		 */
+		node *copy_node(const node *current, node *parent)
+		{
+			auto *copy = this->create_node(parent, current->element);
+			copy->height = current->height;
+			copy->size = current->size;
+			return copy;
+		}
+
+		/**
+		 * Visit every node of the tree in the given order without recursion.
+		 * Each node is entered from its parent, from its left child or from
+		 * its right child, and the node we just left tells us which, so the
+		 * walk only needs the parent links. visit receives the node and its
+		 * depth, with the root at depth 1.
+		 */
+		template <typename Visitor>
+		void traverse(order visit_order, Visitor visit) const
+		{
+			const node *previous = nullptr;
+			const node *current = this->root;
+			auto depth = 0;
+			while (current != nullptr)
+			{
+				const node *next;
+				if (previous == current->parent)
+				{
+					// coming down from the parent, this is the first visit.
+					depth++;
+					if (visit_order == order::pre)
+					{
+						visit(current, depth);
+					} // else, not yet, do_nothing();
+
+					next = current->left != nullptr ? current->left : current->right;
+					if (current->left == nullptr && visit_order == order::in)
+					{
+						visit(current, depth);
+					} // else, the left subtree comes first, do_nothing();
+				}
+				else if (previous == current->left)
+				{
+					// coming up from the left subtree.
+					if (visit_order == order::in)
+					{
+						visit(current, depth);
+					} // else, not the in-order visit, do_nothing();
+
+					next = current->right;
+				}
+				else
+				{
+					// coming up from the right subtree, we are done here.
+					next = nullptr;
+				}
+
+				if (next == nullptr)
+				{
+					if (visit_order == order::post)
+					{
+						visit(current, depth);
+					} // else, already visited, do_nothing();
+
+					next = current->parent;
+					depth--;
+				} // else, go down into the child, do_nothing();
+
+				previous = current;
+				current = next;
+			}
+		}
+
+		/**
+		 * Count the distinct values in a sorted range.
+		 */
+		template <typename ForwardIterator>
+		std::size_t count_unique(ForwardIterator first, ForwardIterator last) const
+		{
+			std::size_t count = 0;
+			for (auto previous = first; first != last; previous = first)
+			{
+				count++;
+				while (++first != last && !this->compare(*previous, *first))
+				{
+					// skip the repeats of this value. do_nothing();
+				}
+			}
+			return count;
+		}
+
+		/**
+		 * Ask the allocator to lay out the next count nodes contiguously, if
+		 * it knows how. The int/long overloads pick the first one that
+		 * compiles.
+		 */
+		template <typename NodeAllocator>
+		static auto reserve_nodes(NodeAllocator &allocator, std::size_t count, int) -> decltype(allocator.reserve(count), void())
+		{
+			allocator.reserve(count);
+		}
+
+		template <typename NodeAllocator>
+		static void reserve_nodes(NodeAllocator &, std::size_t, long) {}
+
+		/**
+		 * Build a perfectly balanced subtree from the next count distinct
+		 * values of a sorted range. The left half is built first so nodes
+		 * are created in sorted order, then the middle value becomes the
+		 * root, then the right half. If an allocation fails, whatever was
+		 * built so far is freed.
+		 */
+		template <typename ForwardIterator>
+		node *build(ForwardIterator &next, ForwardIterator last, std::size_t count, node *parent)
+		{
+			if (count == 0)
+			{
+				return nullptr;
+			} // else, there are values left to place.
+
+			auto left_count = (count - 1) / 2;
+			auto *left = this->build(next, last, left_count, nullptr);
+			node *current;
+			try
+			{
+				current = this->create_node(parent, *next);
+			}
+			catch (...)
+			{
+				this->empty(left);
+				throw;
+			}
+
+			while (++next != last && !this->compare(current->element, *next))
+			{
+				// skip the repeats of this value. do_nothing();
+			}
+
+			current->left = left;
+			if (left != nullptr)
+			{
+				left->parent = current;
+			} // else, no left half, do_nothing();
+
+			try
+			{
+				current->right = this->build(next, last, count - 1 - left_count, current);
+			}
+			catch (...)
+			{
+				this->empty(current);
+				throw;
+			}
+			update(current);
+			return current;
+		}
+
+		/**
+		 * Delete every node of the subtree and set the link to nullptr.
+		 * Whenever the current node has a left child, rotate it up to the
+		 * right; once there is no left child the node can be deleted and we
+		 * carry on with its right child. Each rotation takes one node off
+		 * the left spine for good, so this is O(n) with no stack.
+		 */
+		void empty(node *&current)
+		{
+			auto *next = current;
+			while (next != nullptr)
+			{
+				if (next->left != nullptr)
+				{
+					auto *left = next->left;
+					next->left = left->right;
+					left->right = next;
+					next = left;
+				}
+				else
+				{
+					auto *right = next->right;
+					this->destroy_node(next);
+					next = right;
+				}
+			}
+			current = nullptr;
+		}
+
+		/**
+		 * Find the node holding the value, or return nullptr if the value
+		 * is not in the tree.
+		 */
+		template <typename Key>
+		node *find_node(const Key &value) const
+		{
+			auto scope = this->record(tree_operation::lookup);
+			auto *current = this->root;
+			while (current != nullptr)
+			{
+				if (scope.counted(this->compare(value, current->element)))
+				{
+					current = current->left;
+				}
+				else if (scope.counted(this->compare(current->element, value)))
+				{
+					current = current->right;
+				}
+				else
+				{
+					return current;
+				}
+			}
+			return nullptr;
+		}
+
+		/**
+		 * Find the node with the smallest value that is not less than the
+		 * given value. Every time we go left the current node is the best
+		 * candidate so far.
+		 */
+		template <typename Key>
+		node *lower_bound_node(const Key &value) const
+		{
+			auto scope = this->record(tree_operation::lookup);
+			node *result = nullptr;
+			auto *current = this->root;
+			while (current != nullptr)
+			{
+				if (scope.counted(this->compare(current->element, value)))
+				{
+					current = current->right;
+				}
+				else
+				{
+					result = current;
+					current = current->left;
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * Find the node holding the k-th smallest value by comparing k with
+		 * the size of each left subtree on the way down.
+		 */
+		node *select_node(std::size_t k) const
+		{
+			auto *current = this->root;
+			while (current != nullptr)
+			{
+				auto left_size = subtree_size(current->left);
+				if (k < left_size)
+				{
+					current = current->left;
+				}
+				else if (k == left_size)
+				{
+					return current;
+				}
+				else
+				{
+					k -= left_size + 1;
+					current = current->right;
+				}
+			}
+			return nullptr;
+		}
+
+		/**
+		 * Find the node with the smallest value greater than the given value.
+		 */
+		template <typename Key>
+		node *upper_bound_node(const Key &value) const
+		{
+			auto scope = this->record(tree_operation::lookup);
+			node *result = nullptr;
+			auto *current = this->root;
+			while (current != nullptr)
+			{
+				if (scope.counted(this->compare(value, current->element)))
+				{
+					result = current;
+					current = current->left;
+				}
+				else
+				{
+					current = current->right;
+				}
+			}
+			return result;
+		}
+
+		/**
+		 * Walk down from the root to the empty link where the key belongs.
+		 * If the key is less than the current node, go left.
+		 * If the key is greater than the current node, go right.
+		 * Return the empty link, with parent set to the node it hangs from.
+		 * If a duplicate is found, return nullptr with parent set to it.
+		 */
+		template <typename Key>
+		node **find_slot(const Key &key, node *&parent)
+		{
+			parent = nullptr;
+			node **link = &this->root;
+			while (*link != nullptr)
+			{
+				parent = *link;
+				if (this->compare(key, parent->element))
+				{
+					link = &parent->left;
+				}
+				else if (this->compare(parent->element, key))
+				{
+					link = &parent->right;
+				}
+				else
+				{
+					// we found a duplicate.
+					return nullptr;
+				}
+			}
+			return link;
+		}
+
+		/**
+		 * Hang a new leaf from the empty link find_slot returned and fix up
+		 * the tree above it.
+		 */
+		void link_node(node **link, node *current)
+		{
+			*link = current;
+			this->repair(current->parent);
+		}
+
+		/**
+		 * Construct a value from args under the empty link for key, unless a
+		 * value equal to key is already present.
+		 */
+		template <typename Key, typename... Args>
+		std::pair<iterator, bool> try_emplace_key(const Key &key, Args &&... args)
+		{
+			auto scope = this->record(tree_operation::insert);
+			node *parent;
+			auto **link = this->find_slot(key, parent);
+			if (link == nullptr)
+			{
+				return { iterator(this, parent), false };
+			} // else, there is a free spot for it.
+
+			auto *current = this->create_node(parent, std::forward<Args>(args)...);
+			this->link_node(link, current);
+			return { iterator(this, current), true };
+		}
+
+		/**
+		 * Insert a value unless an equal one is present, forwarding it into
+		 * the new node so rvalues are moved rather than copied.
+		 */
+		template <typename Value>
+		std::pair<iterator, bool> insert_unique(Value &&value)
+		{
+			auto scope = this->record(tree_operation::insert);
+			node *parent;
+			auto **link = this->find_slot(value, parent);
+			if (link == nullptr)
+			{
+				// we found a duplicate. do_nothing();
+				return { iterator(this, parent), false };
+			} // else, there is a free spot for it.
+
+			auto *current = this->create_node(parent, std::forward<Value>(value));
+			this->link_node(link, current);
+			return { iterator(this, current), true };
+		}
+
+		/**
+		 * Find the value and unlink its node from the tree.
+		 */
+		template <typename Key>
+		void remove(const Key &value, node *current)
+		{
+			auto scope = this->record(tree_operation::remove);
+			while (current != nullptr)
+			{
+				if (this->compare(value, current->element))
+				{
+					current = current->left;
+				}
+				else if (this->compare(current->element, value))
+				{
+					current = current->right;
+				}
 				else
 				{
-					current = new node{ value, nullptr, nullptr, parent };
-					return iterator( current );
+					this->remove_node(current);
+					return;
 				}
 			}
-			else if (value < current->element)
+			// we did not find the item to remove, we found nullptr. 
+		}
+
+		/**
+		 * Unlink the current node from the tree and delete it. A node with two
+		 * children is replaced by its in-order successor, so nodes are relinked
+		 * rather than having their elements copied around.
+		 */
+		void remove_node(node *current)
+		{
+			node *changed;
+			if (current->left != nullptr && current->right != nullptr)
+			{
+				// we have two children!
+				node *successor = this->find_min(current->right);
+				if (successor->parent == current)
+				{
+					changed = successor;
+				}
+				else
+				{
+					changed = successor->parent;
+					this->replace_child(successor, successor->right);
+					successor->right = current->right;
+					successor->right->parent = successor;
+				}
+				this->replace_child(current, successor);
+				successor->left = current->left;
+				successor->left->parent = successor;
+				successor->height = current->height;
+			}
+			else
+			{
+				// we have either one child or no children :(
+				changed = current->parent;
+				this->replace_child(current, (current->left != nullptr) ? current->left : current->right);
+			}
+			this->destroy_node(current);
+			this->repair(changed);
+		}
+
+		/**
+		 * Point whatever referenced the old node (its parent or the root) at
+		 * the replacement node instead.
+		 */
+		void replace_child(node *old_node, node *replacement)
+		{
+			if (old_node->parent == nullptr)
 			{
-				this->insert(value, current->left, current);
+				this->root = replacement;
 			}
-			else if (current->element < value)
+			else if (old_node->parent->left == old_node)
 			{
-				this->insert(value, current->right, current);
+				old_node->parent->left = replacement;
 			}
 			else
 			{
-				// we found a duplicate. do_nothing();
-				return{};
+				old_node->parent->right = replacement;
 			}
+
+			if (replacement != nullptr)
+			{
+				replacement->parent = old_node->parent;
+			} // else, the link is now empty, do_nothing();
+		}
+
+		static int height(const node *current)
+		{
+			return current == nullptr ? 0 : current->height;
+		}
+
+		static std::size_t subtree_size(const node *current)
+		{
+			return current == nullptr ? 0 : current->size;
 		}
 
 		/**
-		 * Remove the current node from the tree and replace it with a nullptr.
+		 * Recompute the height and size of the current node from its children.
 		 */
-		void remove(const T &value, node *&current)
+		static void update(node *current)
 		{
-			if (current == nullptr)
+			current->height = 1 + std::max(height(current->left), height(current->right));
+			current->size = 1 + subtree_size(current->left) + subtree_size(current->right);
+		}
+
+		/**
+		 * Walk up the parent links from the lowest node that changed, fixing
+		 * subtree sizes, and for self balancing trees heights and balance.
+		 */
+		void repair(node *current)
+		{
+			if (Balance::kSelfBalancing)
 			{
-				// we did not find the item to remove, we found nullptr. 
+				this->rebalance(current);
 				return;
-			} // else, we are still looking, do_nothing();
+			} // else, only the sizes need fixing.
+
+			while (current != nullptr)
+			{
+				current->size = 1 + subtree_size(current->left) + subtree_size(current->right);
+				current = current->parent;
+			}
+		}
+
+		/**
+		 * Find the depth of the deepest node with a full walk.
+		 */
+		int measure_height() const
+		{
+			auto deepest = 0;
+			this->traverse(order::pre, [&deepest](const node *, int depth) {
+				deepest = std::max(deepest, depth);
+			});
+			return deepest;
+		}
+
+		/**
+		 * Rotate the current node down to the left and return the right
+		 * child that took its place.
+		 */
+		node *rotate_left(node *current)
+		{
+			node *pivot = current->right;
+			current->right = pivot->left;
+			if (pivot->left != nullptr)
+			{
+				pivot->left->parent = current;
+			} // else, nothing to move across, do_nothing();
+
+			this->replace_child(current, pivot);
+			pivot->left = current;
+			current->parent = pivot;
+			update(current);
+			update(pivot);
+			return pivot;
+		}
+
+		/**
+		 * Rotate the current node down to the right and return the left
+		 * child that took its place.
+		 */
+		node *rotate_right(node *current)
+		{
+			node *pivot = current->left;
+			current->left = pivot->right;
+			if (pivot->right != nullptr)
+			{
+				pivot->right->parent = current;
+			} // else, nothing to move across, do_nothing();
+
+			this->replace_child(current, pivot);
+			pivot->right = current;
+			current->parent = pivot;
+			update(current);
+			update(pivot);
+			return pivot;
+		}
+
+		/**
+		 * Walk up the parent links from the current node, repairing heights
+		 * and sizes and rotating any node whose children differ in height by more than
+		 * one. Left-right and right-left cases take a double rotation.
+		 */
+		void rebalance(node *current)
+		{
+			while (current != nullptr)
+			{
+				update(current);
+				auto balance = height(current->left) - height(current->right);
+				if (balance > 1)
+				{
+					if (height(current->left->left) < height(current->left->right))
+					{
+						this->rotate_left(current->left);
+					} // else, a single rotation is enough, do_nothing();
+					current = this->rotate_right(current);
+				}
+				else if (balance < -1)
+				{
+					if (height(current->right->right) < height(current->right->left))
+					{
+						this->rotate_right(current->right);
+					} // else, a single rotation is enough, do_nothing();
+					current = this->rotate_left(current);
+				} // else, this node is balanced, do_nothing();
+
+				current = current->parent;
+			}
+		}
+
+		// below this combined size the set operations stop forking.
+		static const std::size_t kParallelCutoff = 1 << 14;
+
+		/**
+		 * A list of detached subtrees thrown out by a set operation, linked
+		 * through the parent pointers of their roots. The parallel halves
+		 * of an operation keep lists of their own, and the nodes are only
+		 * destroyed at the end, on the calling thread, because allocators
+		 * such as pool_allocator are not thread safe.
+		 */
+		struct node_chain
+		{
+			node *head = nullptr;
+			node *tail = nullptr;
 
-			if (value < current->element)
+			void push(node *current)
 			{
-				this->remove(value, current->left);
+				current->parent = nullptr;
+				if (this->tail == nullptr)
+				{
+					this->head = current;
+				}
+				else
+				{
+					this->tail->parent = current;
+				}
+				this->tail = current;
 			}
-			else if (current->element < value)
+
+			void splice(node_chain &other)
 			{
-				this->remove(value, current->right);
+				if (other.head == nullptr)
+				{
+					return;
+				}
+				else if (this->tail == nullptr)
+				{
+					this->head = other.head;
+				}
+				else
+				{
+					this->tail->parent = other.head;
+				}
+				this->tail = other.tail;
+				other.head = other.tail = nullptr;
 			}
-			else if (current->left != nullptr && current->right != nullptr)
+		};
+
+		/**
+		 * Detach the new root from whatever it hung from and free the nodes
+		 * the operation threw out.
+		 */
+		void finish(node_chain &discarded)
+		{
+			detach(this->root);
+			auto *current = discarded.head;
+			while (current != nullptr)
 			{
-				// we have two children!
-				current->element = this->find_min(current->right)->element;
-				this->remove(current->element, current->right);
+				auto *next = current->parent;
+				this->empty(current);
+				current = next;
 			}
-			else
+		}
+
+		static node *detach(node *current)
+		{
+			if (current != nullptr)
 			{
-				// we have either one child or no children :(
-				node *old_node = current;
-				current = (current->left != nullptr) ? current->left : current->right;
-				delete old_node;
+				current->parent = nullptr;
+			} // else, nothing to detach, do_nothing();
+			return current;
+		}
+
+		/**
+		 * Hang the given subtrees under the current node and recompute its
+		 * height and size.
+		 */
+		static node *attach(node *current, node *left, node *right)
+		{
+			current->left = left;
+			current->right = right;
+			if (left != nullptr)
+			{
+				left->parent = current;
+			} // else, no left subtree, do_nothing();
+
+			if (right != nullptr)
+			{
+				right->parent = current;
+			} // else, no right subtree, do_nothing();
+
+			update(current);
+			return current;
+		}
+
+		/**
+		 * Rotations for subtrees that are not linked into the tree yet. The
+		 * new subtree root is returned for the caller to attach.
+		 */
+		static node *rotate_subtree_left(node *current)
+		{
+			auto *pivot = current->right;
+			attach(current, current->left, pivot->left);
+			return attach(pivot, current, pivot->right);
+		}
+
+		static node *rotate_subtree_right(node *current)
+		{
+			auto *pivot = current->left;
+			attach(current, pivot->right, current->right);
+			return attach(pivot, pivot->left, current);
+		}
+
+		/**
+		 * Build a balanced tree holding left, then middle, then right, where
+		 * every value in left is less than middle and every value in right
+		 * is greater. The shorter tree is hung from the spine of the taller
+		 * one where the heights meet and rotations fix the way back up, so
+		 * this costs O(1 + the difference in height).
+		 */
+		static node *join_trees(node *left, node *middle, node *right)
+		{
+			if (height(left) > height(right) + 1)
+			{
+				return join_right(left, middle, right);
+			}
+			else if (height(right) > height(left) + 1)
+			{
+				return join_left(left, middle, right);
+			} // else, the heights are close enough to meet here.
+
+			return attach(middle, left, right);
+		}
+
+		/**
+		 * Join when left is the taller tree, walking down its right spine.
+		 */
+		static node *join_right(node *left, node *middle, node *right)
+		{
+			auto *inner = left->right;
+			if (height(inner) <= height(right) + 1)
+			{
+				auto *joined = attach(middle, inner, right);
+				if (height(joined) <= height(left->left) + 1)
+				{
+					return attach(left, left->left, joined);
+				} // else, left-right case, take the double rotation.
+
+				attach(left, left->left, rotate_subtree_right(joined));
+				return rotate_subtree_left(left);
+			} // else, keep going down the spine.
+
+			auto *joined = join_right(inner, middle, right);
+			attach(left, left->left, joined);
+			if (height(joined) <= height(left->left) + 1)
+			{
+				return left;
+			} // else, the spine grew too tall here.
+
+			return rotate_subtree_left(left);
+		}
+
+		/**
+		 * Join when right is the taller tree, walking down its left spine.
+		 */
+		static node *join_left(node *left, node *middle, node *right)
+		{
+			auto *inner = right->left;
+			if (height(inner) <= height(left) + 1)
+			{
+				auto *joined = attach(middle, left, inner);
+				if (height(joined) <= height(right->right) + 1)
+				{
+					return attach(right, joined, right->right);
+				} // else, right-left case, take the double rotation.
+
+				attach(right, rotate_subtree_left(joined), right->right);
+				return rotate_subtree_right(right);
+			} // else, keep going down the spine.
+
+			auto *joined = join_left(left, middle, inner);
+			attach(right, joined, right->right);
+			if (height(joined) <= height(right->right) + 1)
+			{
+				return right;
+			} // else, the spine grew too tall here.
+
+			return rotate_subtree_right(right);
+		}
+
+		/**
+		 * Take the largest node out of a subtree, returning what is left.
+		 */
+		static node *split_last(node *current, node *&last)
+		{
+			if (current->right == nullptr)
+			{
+				last = current;
+				return detach(current->left);
+			} // else, the largest is further right.
+
+			auto *rest = split_last(current->right, last);
+			return join_trees(detach(current->left), current, rest);
+		}
+
+		/**
+		 * Join two subtrees, every value of left being less than every value
+		 * of right, with the largest node of left as the middle.
+		 */
+		static node *concatenate(node *left, node *right)
+		{
+			if (left == nullptr)
+			{
+				return right;
+			} // else, borrow the largest node of left to join with.
+
+			node *last;
+			auto *rest = split_last(left, last);
+			return join_trees(rest, last, right);
+		}
+
+		/**
+		 * Take a subtree apart into the values less than key, which end up
+		 * in left, and the values greater, which end up in right. Return the
+		 * node equal to key, detached, or nullptr if there is none.
+		 */
+		node *split_at(node *current, const T &key, node *&left, node *&right) const
+		{
+			if (current == nullptr)
+			{
+				left = right = nullptr;
+				return nullptr;
+			} // else, split the side key falls in and join the rest back on.
+
+			auto *lower = detach(current->left);
+			auto *upper = detach(current->right);
+			if (this->compare(key, current->element))
+			{
+				auto *match = this->split_at(lower, key, left, right);
+				right = join_trees(right, current, upper);
+				return match;
+			}
+			else if (this->compare(current->element, key))
+			{
+				auto *match = this->split_at(upper, key, left, right);
+				left = join_trees(lower, current, left);
+				return match;
+			} // else, this is the node we were looking for.
+
+			left = lower;
+			right = upper;
+			return attach(current, nullptr, nullptr);
+		}
+
+		/**
+		 * Run the two halves of a set operation, the first on a new thread
+		 * if there are threads to spare and enough work to be worth it.
+		 * Each half is passed the number of threads it may use and the list
+		 * to throw its nodes out to.
+		 */
+		template <typename First, typename Second>
+		static void fork(std::size_t work, unsigned threads, node_chain &discarded, First first, Second second)
+		{
+			if (threads > 1 && work >= kParallelCutoff)
+			{
+				auto half = threads / 2;
+				node_chain first_discarded;
+				std::future<void> task;
+				try
+				{
+					task = std::async(std::launch::async, [&]() { first(half, first_discarded); });
+				}
+				catch (const std::system_error &)
+				{
+					// no thread to be had, run both halves here.
+					first(1, discarded);
+					second(threads - half, discarded);
+					return;
+				}
+
+				second(threads - half, discarded);
+				task.get();
+				discarded.splice(first_discarded);
+				return;
+			} // else, do both halves on this thread.
+
+			first(threads, discarded);
+			second(threads, discarded);
+		}
+
+		/**
+		 * Merge two detached subtrees into one holding every value of both.
+		 * The root of second splits first; the halves are merged with its
+		 * children and joined back with it in the middle. When both trees
+		 * hold a value the node from first is thrown out.
+		 */
+		node *unite(node *first, node *second, unsigned threads, node_chain &discarded)
+		{
+			if (first == nullptr)
+			{
+				return second;
+			}
+			else if (second == nullptr)
+			{
+				return first;
+			} // else, both trees have values.
+
+			node *lower;
+			node *upper;
+			auto *match = this->split_at(first, second->element, lower, upper);
+			if (match != nullptr)
+			{
+				discarded.push(match);
+			} // else, the value is new, do_nothing();
+
+			auto *second_lower = detach(second->left);
+			auto *second_upper = detach(second->right);
+			auto work = subtree_size(lower) + subtree_size(upper) + second->size;
+			node *left;
+			node *right;
+			fork(work, threads, discarded,
+				[&](unsigned half, node_chain &thrown) { left = this->unite(lower, second_lower, half, thrown); },
+				[&](unsigned half, node_chain &thrown) { right = this->unite(upper, second_upper, half, thrown); });
+			return join_trees(left, second, right);
+		}
+
+		/**
+		 * Cut a detached subtree down to the values also found under second,
+		 * which is only read.
+		 */
+		node *intersection(node *first, const node *second, unsigned threads, node_chain &discarded)
+		{
+			if (first == nullptr)
+			{
+				return nullptr;
 			}
+			else if (second == nullptr)
+			{
+				discarded.push(first);
+				return nullptr;
+			} // else, both trees have values.
+
+			node *lower;
+			node *upper;
+			auto *match = this->split_at(first, second->element, lower, upper);
+			auto work = subtree_size(lower) + subtree_size(upper) + second->size;
+			node *left;
+			node *right;
+			fork(work, threads, discarded,
+				[&](unsigned half, node_chain &thrown) { left = this->intersection(lower, second->left, half, thrown); },
+				[&](unsigned half, node_chain &thrown) { right = this->intersection(upper, second->right, half, thrown); });
+			if (match != nullptr)
+			{
+				return join_trees(left, match, right);
+			} // else, the value was only in second.
+
+			return concatenate(left, right);
+		}
+
+		/**
+		 * Cut the values found under second, which is only read, out of a
+		 * detached subtree.
+		 */
+		node *subtract(node *first, const node *second, unsigned threads, node_chain &discarded)
+		{
+			if (first == nullptr || second == nullptr)
+			{
+				return first;
+			} // else, both trees have values.
+
+			node *lower;
+			node *upper;
+			auto *match = this->split_at(first, second->element, lower, upper);
+			if (match != nullptr)
+			{
+				discarded.push(match);
+			} // else, the value was only in second.
+
+			auto work = subtree_size(lower) + subtree_size(upper) + second->size;
+			node *left;
+			node *right;
+			fork(work, threads, discarded,
+				[&](unsigned half, node_chain &thrown) { left = this->subtract(lower, second->left, half, thrown); },
+				[&](unsigned half, node_chain &thrown) { right = this->subtract(upper, second->right, half, thrown); });
+			return concatenate(left, right);
 		}
 
 		/**
 		 * Find the left most node in the tree. This should represent the
 		 * lowest value in the tree.
 		 */
-		node *find_min(node *current) const
+		static node *find_min(node *current)
 		{
 			if (current == nullptr)
 			{
 				return nullptr;
 			} // else, current is not null, do_nothing();
 
-			if (current->left == nullptr)
+			while (current->left != nullptr)
+			{
+				current = current->left;
+			}
+			return current;
+		}
+
+		/**
+		 * Find the right most node in the tree. This should represent the
+		 * highest value in the tree.
+		 */
+		static node *find_max(node *current)
+		{
+			if (current == nullptr)
 			{
-				return current;
-			} // else, we still have more children do_nothing();
+				return nullptr;
+			} // else, current is not null, do_nothing();
 
-			return this->find_min(current->left);
+			while (current->right != nullptr)
+			{
+				current = current->right;
+			}
+			return current;
 		}
 
 		/**
 		 * Finds the next node in the tree set.
-		 * If the right child of the current node is equal to a null pointer,
-		 * then return the value of the current node as the smallest value in the tree set.
-		 * Else the current node is a child. Move up the tree.
+		 * If the current node has a right child, the next node is the
+		 * smallest value in that subtree.
+		 * Else the current node is a child. Move up the tree until we come
+		 * up from a left child; that parent is next.
 		 */
-		node *find_next_node(node *current)
+		static node *find_next_node(node *current)
 		{
 			if (current->right != nullptr)
 			{
@@ -525,6 +2170,25 @@ namespace nwacc
 				return current->parent;
 			}
 		}
+
+		/**
+		 * Finds the previous node in the tree set, mirroring find_next_node.
+		 */
+		static node *find_previous_node(node *current)
+		{
+			if (current->left != nullptr)
+			{
+				return find_max(current->left);
+			}
+			else
+			{
+				while (current->parent != nullptr && current == current->parent->left)
+				{
+					current = current->parent;
+				}
+				return current->parent;
+			}
+		}
 	};
 }
 
@@ -0,0 +1,215 @@
+#ifndef TREE_FILE_H_
+#define TREE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "flat_tree.h"
+
+namespace nwacc
+{
+	/**
+	 * The binary file format tree::save writes and tree::load and
+	 * mapped_tree read: a 64 byte header followed by the values as raw
+	 * bytes, either in sorted order or in the Eytzinger order flat_tree
+	 * searches (with an unused slot 0, so the array can be searched as it
+	 * lies). The values start on a 64 byte boundary, so a mapped file can
+	 * be used in place. Files are written in the byte order of the machine
+	 * and are only meant to be read back on the same kind of machine; the
+	 * header records enough to refuse anything else.
+	 */
+	namespace tree_file
+	{
+		enum class layout : std::uint32_t
+		{
+			sorted = 0,
+			eytzinger = 1
+		};
+
+		struct header
+		{
+			char magic[8];
+			std::uint32_t version;
+			// kByteOrderMark as written by the machine that saved the file.
+			std::uint32_t byte_order;
+			std::uint32_t element_size;
+			std::uint32_t element_layout;
+			std::uint64_t count;
+			char reserved[32];
+		};
+
+		static_assert(sizeof(header) == 64, "the values must start on a cache line");
+
+		const char kMagic[8] = { 'N', 'W', 'A', 'C', 'C', 'T', 'R', 'E' };
+		const std::uint32_t kVersion = 1;
+		const std::uint32_t kByteOrderMark = 0x01020304;
+
+		inline header make_header(std::size_t element_size, layout element_layout, std::size_t count)
+		{
+			header result{};
+			std::memcpy(result.magic, kMagic, sizeof(kMagic));
+			result.version = kVersion;
+			result.byte_order = kByteOrderMark;
+			result.element_size = static_cast<std::uint32_t>(element_size);
+			result.element_layout = static_cast<std::uint32_t>(element_layout);
+			result.count = count;
+			return result;
+		}
+
+		/**
+		 * Throw std::runtime_error unless the header describes values of the
+		 * given size that this code can read.
+		 */
+		inline void check_header(const header &file_header, std::size_t element_size, const std::string &path)
+		{
+			if (std::memcmp(file_header.magic, kMagic, sizeof(kMagic)) != 0)
+			{
+				throw std::runtime_error("Not a tree file: " + path);
+			}
+			else if (file_header.version != kVersion || file_header.byte_order != kByteOrderMark)
+			{
+				throw std::runtime_error("Unsupported tree file version or byte order: " + path);
+			}
+			else if (file_header.element_size != element_size)
+			{
+				throw std::runtime_error("Tree file holds values of a different size: " + path);
+			}
+			else if (file_header.element_layout > static_cast<std::uint32_t>(layout::eytzinger))
+			{
+				throw std::runtime_error("Unknown layout in tree file: " + path);
+			} // else, the file can be read, do_nothing();
+		}
+
+		/**
+		 * Return how many values the array following the header holds,
+		 * counting the unused slot of the Eytzinger layout.
+		 */
+		inline std::size_t stored_count(const header &file_header)
+		{
+			auto count = static_cast<std::size_t>(file_header.count);
+			return file_header.element_layout == static_cast<std::uint32_t>(layout::eytzinger) ? count + 1 : count;
+		}
+
+		/**
+		 * Throw unless the values the header counts fit in the bytes that
+		 * follow it. The count comes from the file, so it is compared
+		 * against what there is room for rather than multiplied out, which
+		 * a corrupt count could wrap around.
+		 */
+		inline void check_count(const header &file_header, std::uint64_t bytes_after_header, std::size_t element_size, const std::string &path)
+		{
+			auto room = bytes_after_header / element_size;
+			auto extra = file_header.element_layout == static_cast<std::uint32_t>(layout::eytzinger) ? 1u : 0u;
+			if (room < extra || file_header.count > room - extra)
+			{
+				throw std::runtime_error("Tree file is truncated: " + path);
+			} // else, every value is there.
+		}
+
+		/**
+		 * Write count values from a sorted range of unique values to path.
+		 * The sorted layout is streamed out a chunk at a time; the Eytzinger
+		 * layout is arranged in memory first.
+		 */
+		template <typename T, typename InputIterator>
+		void write(const std::string &path, InputIterator first, std::size_t count, layout element_layout)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be saved as bytes");
+			std::ofstream out{ path, std::ios::binary | std::ios::trunc };
+			if (!out)
+			{
+				throw std::runtime_error("Cannot open tree file for writing: " + path);
+			} // else, the file is open.
+
+			auto file_header = make_header(sizeof(T), element_layout, count);
+			out.write(reinterpret_cast<const char *>(&file_header), sizeof(file_header));
+			if (element_layout == layout::eytzinger)
+			{
+				std::vector<T> elements(count + 1);
+				for (auto index = eytzinger::first(count); index != 0; index = eytzinger::next(index, count))
+				{
+					elements[index] = *first;
+					++first;
+				}
+				out.write(reinterpret_cast<const char *>(elements.data()), elements.size() * sizeof(T));
+			}
+			else
+			{
+				const std::size_t kChunk = 4096;
+				std::vector<T> chunk;
+				chunk.reserve(kChunk);
+				for (std::size_t written = 0; written < count; written += chunk.size())
+				{
+					chunk.clear();
+					while (chunk.size() < kChunk && written + chunk.size() < count)
+					{
+						chunk.push_back(*first);
+						++first;
+					}
+					out.write(reinterpret_cast<const char *>(chunk.data()), chunk.size() * sizeof(T));
+				}
+			}
+
+			if (!out.flush())
+			{
+				throw std::runtime_error("Failed writing tree file: " + path);
+			} // else, everything made it out.
+		}
+
+		/**
+		 * Read the values stored in path back in sorted order.
+		 */
+		template <typename T>
+		std::vector<T> read_sorted(const std::string &path)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable values can be loaded as bytes");
+			std::ifstream in{ path, std::ios::binary };
+			header file_header;
+			if (!in || !in.read(reinterpret_cast<char *>(&file_header), sizeof(file_header)))
+			{
+				throw std::runtime_error("Cannot read tree file: " + path);
+			} // else, we have a header to check.
+
+			check_header(file_header, sizeof(T), path);
+			// check the count against what the file holds before sizing
+			// anything by it.
+			auto start = in.tellg();
+			in.seekg(0, std::ios::end);
+			auto end = in.tellg();
+			in.seekg(start);
+			if (start < 0 || end < start || !in)
+			{
+				throw std::runtime_error("Cannot read tree file: " + path);
+			} // else, we know how much follows the header.
+
+			check_count(file_header, static_cast<std::uint64_t>(end - start), sizeof(T), path);
+			std::vector<T> stored(stored_count(file_header));
+			if (!in.read(reinterpret_cast<char *>(stored.data()), stored.size() * sizeof(T)))
+			{
+				throw std::runtime_error("Tree file is truncated: " + path);
+			} // else, every value was read.
+
+			if (file_header.element_layout == static_cast<std::uint32_t>(layout::sorted))
+			{
+				return stored;
+			} // else, walk the Eytzinger array in order.
+
+			auto count = static_cast<std::size_t>(file_header.count);
+			std::vector<T> sorted;
+			sorted.reserve(count);
+			for (auto index = eytzinger::first(count); index != 0; index = eytzinger::next(index, count))
+			{
+				sorted.push_back(stored[index]);
+			}
+			return sorted;
+		}
+	}
+}
+
+#endif // TREE_FILE_H_
@@ -0,0 +1,287 @@
+#ifndef TREE_MAP_H_
+#define TREE_MAP_H_
+
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <utility>
+
+#include "tree.h"
+
+namespace nwacc
+{
+	/**
+	 * An ordered map from K to V. Each entry lives in a single tree node
+	 * as a std::pair<const K, V>, so a payload costs no more than its own
+	 * size and is found by the same walk that finds the key.
+	 *
+	 * Keys are ordered by Compare. With a transparent Compare such as
+	 * std::less<>, find, contains, remove and the bounds accept anything
+	 * Compare can order against K (a const char * or std::string_view
+	 * against std::string keys, say) without building a temporary K.
+	 *
+	 * Unlike tree, the map balances itself (AVL) unless told otherwise.
+	 */
+	template <typename K, typename V, typename Compare = std::less<K>, typename Balance = avl,
+		typename Allocator = std::allocator<std::pair<const K, V>>>
+	class tree_map
+	{
+	public:
+		using key_type = K;
+		using mapped_type = V;
+		using value_type = std::pair<const K, V>;
+
+	private:
+		/**
+		 * Orders entries by their keys, and entries against bare keys so the
+		 * tree can search for a key without an entry to hold it.
+		 */
+		struct entry_compare
+		{
+			using is_transparent = void;
+
+			Compare compare;
+
+			bool operator()(const value_type &lhs, const value_type &rhs) const
+			{
+				return this->compare(lhs.first, rhs.first);
+			}
+
+			template <typename Key>
+			bool operator()(const value_type &lhs, const Key &rhs) const
+			{
+				return this->compare(lhs.first, rhs);
+			}
+
+			template <typename Key>
+			bool operator()(const Key &lhs, const value_type &rhs) const
+			{
+				return this->compare(lhs, rhs.first);
+			}
+		};
+
+		using entry_tree = tree<value_type, Balance, Allocator, entry_compare>;
+
+	public:
+		using iterator = typename entry_tree::iterator;
+		using const_iterator = typename entry_tree::const_iterator;
+
+		tree_map() = default;
+
+		explicit tree_map(const Compare &compare, const Allocator &allocator = Allocator()) :
+			entries{ entry_compare{ compare }, allocator } {}
+
+		/**
+		 * Insert the entry unless its key is already present. Return an
+		 * iterator to the entry with that key and whether it was inserted.
+		 */
+		std::pair<iterator, bool> insert(const value_type &entry)
+		{
+			return this->entries.try_emplace(entry.first, entry);
+		}
+
+		std::pair<iterator, bool> insert(value_type &&entry)
+		{
+			return this->entries.try_emplace(entry.first, std::move(entry));
+		}
+
+		/**
+		 * Insert an entry for key built from args, unless the key is already
+		 * present. Nothing is constructed for a key that is.
+		 */
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(const K &key, Args &&... args)
+		{
+			return this->entries.try_emplace(key, std::piecewise_construct,
+				std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+		}
+
+		template <typename... Args>
+		std::pair<iterator, bool> try_emplace(K &&key, Args &&... args)
+		{
+			// the key is only moved from once the search is over.
+			return this->entries.try_emplace(key, std::piecewise_construct,
+				std::forward_as_tuple(std::move(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+		}
+
+		/**
+		 * Insert the value under key, or assign it over the value already
+		 * there. Return an iterator to the entry and whether it was inserted.
+		 */
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(const K &key, M &&value)
+		{
+			auto result = this->try_emplace(key, std::forward<M>(value));
+			if (!result.second)
+			{
+				// the value was not used by the failed insert, so it can
+				// still be forwarded here.
+				result.first->second = std::forward<M>(value);
+			} // else, the new entry already holds it, do_nothing();
+			return result;
+		}
+
+		template <typename M>
+		std::pair<iterator, bool> insert_or_assign(K &&key, M &&value)
+		{
+			auto result = this->try_emplace(std::move(key), std::forward<M>(value));
+			if (!result.second)
+			{
+				result.first->second = std::forward<M>(value);
+			} // else, the new entry already holds it, do_nothing();
+			return result;
+		}
+
+		/**
+		 * Return the value stored under key, inserting a value initialized
+		 * one first if the key is not present.
+		 */
+		V &operator[](const K &key)
+		{
+			return this->try_emplace(key).first->second;
+		}
+
+		V &operator[](K &&key)
+		{
+			return this->try_emplace(std::move(key)).first->second;
+		}
+
+		/**
+		 * Remove the entry with the given key, if there is one.
+		 */
+		void remove(const K &key)
+		{
+			this->entries.remove(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		void remove(const Key &key)
+		{
+			this->entries.remove(key);
+		}
+
+		/**
+		 * Return an iterator to the entry with the given key, or end() if
+		 * there is none.
+		 */
+		iterator find(const K &key)
+		{
+			return this->entries.find(key);
+		}
+
+		const_iterator find(const K &key) const
+		{
+			return this->entries.find(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator find(const Key &key)
+		{
+			return this->entries.find(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator find(const Key &key) const
+		{
+			return this->entries.find(key);
+		}
+
+		bool contains(const K &key) const
+		{
+			return this->entries.contains(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		bool contains(const Key &key) const
+		{
+			return this->entries.contains(key);
+		}
+
+		/**
+		 * Return an iterator to the first entry whose key is not less than
+		 * the given key, or end() if there is none.
+		 */
+		iterator lower_bound(const K &key)
+		{
+			return this->entries.lower_bound(key);
+		}
+
+		const_iterator lower_bound(const K &key) const
+		{
+			return this->entries.lower_bound(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator lower_bound(const Key &key)
+		{
+			return this->entries.lower_bound(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator lower_bound(const Key &key) const
+		{
+			return this->entries.lower_bound(key);
+		}
+
+		/**
+		 * Return an iterator to the first entry whose key is greater than
+		 * the given key, or end() if there is none.
+		 */
+		iterator upper_bound(const K &key)
+		{
+			return this->entries.upper_bound(key);
+		}
+
+		const_iterator upper_bound(const K &key) const
+		{
+			return this->entries.upper_bound(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		iterator upper_bound(const Key &key)
+		{
+			return this->entries.upper_bound(key);
+		}
+
+		template <typename Key, typename C = Compare, typename = typename C::is_transparent>
+		const_iterator upper_bound(const Key &key) const
+		{
+			return this->entries.upper_bound(key);
+		}
+
+		std::size_t size() const
+		{
+			return this->entries.size();
+		}
+
+		bool is_empty() const
+		{
+			return this->entries.is_empty();
+		}
+
+		iterator begin()
+		{
+			return this->entries.begin();
+		}
+
+		const_iterator begin() const
+		{
+			return this->entries.begin();
+		}
+
+		iterator end()
+		{
+			return this->entries.end();
+		}
+
+		const_iterator end() const
+		{
+			return this->entries.end();
+		}
+
+	private:
+		entry_tree entries;
+	};
+}
+
+#endif // TREE_MAP_H_
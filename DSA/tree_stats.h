@@ -0,0 +1,383 @@
+#ifndef TREE_STATS_H_
+#define TREE_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(NWACC_TREE_STATS)
+#include <atomic>
+#include <chrono>
+#endif
+
+// Only one operation in this many has its latency sampled. Must be a power
+// of two.
+#ifndef NWACC_TREE_STATS_SAMPLE_INTERVAL
+#define NWACC_TREE_STATS_SAMPLE_INTERVAL 64
+#endif
+
+namespace nwacc
+{
+	enum class tree_operation { insert, remove, lookup };
+
+	/**
+	 * The sampled latencies of one kind of operation. Bucket b counts the
+	 * samples that took less than 2^b nanoseconds (and at least 2^(b - 1)),
+	 * the last bucket everything slower.
+	 */
+	struct latency_summary
+	{
+		static const std::size_t kBuckets = 32;
+
+		std::uint64_t samples;
+		std::uint64_t total_nanoseconds;
+		std::uint64_t max_nanoseconds;
+		std::uint64_t buckets[kBuckets];
+	};
+
+	/**
+	 * A snapshot of how a tree has been used and what shape it is in, as
+	 * returned by tree::stats. The counters are only kept when the program
+	 * is built with NWACC_TREE_STATS defined; otherwise counters_enabled is
+	 * false and they are all zero, but the shape is still measured.
+	 *
+	 * Lookups are find, contains, contains_many, lower_bound and
+	 * upper_bound; inserts and removes count every attempt, including
+	 * duplicates and missing values.
+	 */
+	struct tree_stats
+	{
+		bool counters_enabled;
+		std::uint64_t inserts;
+		std::uint64_t removes;
+		std::uint64_t lookups;
+		std::uint64_t lookup_comparisons;
+		std::uint64_t allocations;
+		std::uint64_t deallocations;
+		latency_summary insert_latency;
+		latency_summary remove_latency;
+		latency_summary lookup_latency;
+
+		std::size_t size;
+		int height;
+		// depth_histogram[d] is the number of nodes at depth d + 1, so the
+		// root is counted in depth_histogram[0].
+		std::vector<std::size_t> depth_histogram;
+
+		double comparisons_per_lookup() const
+		{
+			return this->lookups == 0 ? 0.0 : static_cast<double>(this->lookup_comparisons) / this->lookups;
+		}
+
+		/**
+		 * Return the average depth of a node, which is what a successful
+		 * lookup costs. For a balanced tree this is about log2(size) - 1.
+		 */
+		double average_depth() const
+		{
+			std::size_t total = 0;
+			for (std::size_t depth = 0; depth < this->depth_histogram.size(); depth++)
+			{
+				total += (depth + 1) * this->depth_histogram[depth];
+			}
+			return this->size == 0 ? 0.0 : static_cast<double>(total) / this->size;
+		}
+	};
+
+	namespace detail
+	{
+		inline void dump_latency(std::ostream &out, const std::string &name, const char *operation, const latency_summary &latency)
+		{
+			std::uint64_t cumulative = 0;
+			for (std::size_t bucket = 0; bucket < latency_summary::kBuckets; bucket++)
+			{
+				cumulative += latency.buckets[bucket];
+				out << name << "_latency_nanoseconds_bucket{operation=\"" << operation << "\",le=\"";
+				if (bucket + 1 == latency_summary::kBuckets)
+				{
+					out << "+Inf";
+				}
+				else
+				{
+					out << (std::uint64_t{ 1 } << bucket);
+				}
+				out << "\"} " << cumulative << '\n';
+			}
+			out << name << "_latency_nanoseconds_sum{operation=\"" << operation << "\"} " << latency.total_nanoseconds << '\n'
+				<< name << "_latency_nanoseconds_count{operation=\"" << operation << "\"} " << latency.samples << '\n';
+		}
+	}
+
+	/**
+	 * Write the snapshot in the Prometheus text exposition format, every
+	 * metric name starting with name, so it can be served as is to a
+	 * scraper. The counters are left out when they were not kept.
+	 */
+	inline void dump(const tree_stats &stats, std::ostream &out, const std::string &name = "nwacc_tree")
+	{
+		out << "# TYPE " << name << "_size gauge\n"
+			<< name << "_size " << stats.size << '\n'
+			<< "# TYPE " << name << "_height gauge\n"
+			<< name << "_height " << stats.height << '\n'
+			<< "# TYPE " << name << "_depth_nodes gauge\n";
+		for (std::size_t depth = 0; depth < stats.depth_histogram.size(); depth++)
+		{
+			out << name << "_depth_nodes{depth=\"" << depth + 1 << "\"} " << stats.depth_histogram[depth] << '\n';
+		}
+
+		if (!stats.counters_enabled)
+		{
+			return;
+		} // else, add the counters.
+
+		out << "# TYPE " << name << "_operations_total counter\n"
+			<< name << "_operations_total{operation=\"insert\"} " << stats.inserts << '\n'
+			<< name << "_operations_total{operation=\"remove\"} " << stats.removes << '\n'
+			<< name << "_operations_total{operation=\"lookup\"} " << stats.lookups << '\n'
+			<< "# TYPE " << name << "_lookup_comparisons_total counter\n"
+			<< name << "_lookup_comparisons_total " << stats.lookup_comparisons << '\n'
+			<< "# TYPE " << name << "_node_allocations_total counter\n"
+			<< name << "_node_allocations_total " << stats.allocations << '\n'
+			<< "# TYPE " << name << "_node_deallocations_total counter\n"
+			<< name << "_node_deallocations_total " << stats.deallocations << '\n'
+			<< "# TYPE " << name << "_latency_nanoseconds histogram\n";
+		detail::dump_latency(out, name, "insert", stats.insert_latency);
+		detail::dump_latency(out, name, "remove", stats.remove_latency);
+		detail::dump_latency(out, name, "lookup", stats.lookup_latency);
+
+		// a histogram may only have buckets, a sum and a count, so the
+		// slowest sample is a family of its own.
+		out << "# TYPE " << name << "_latency_nanoseconds_max gauge\n"
+			<< name << "_latency_nanoseconds_max{operation=\"insert\"} " << stats.insert_latency.max_nanoseconds << '\n'
+			<< name << "_latency_nanoseconds_max{operation=\"remove\"} " << stats.remove_latency.max_nanoseconds << '\n'
+			<< name << "_latency_nanoseconds_max{operation=\"lookup\"} " << stats.lookup_latency.max_nanoseconds << '\n';
+	}
+
+#if defined(NWACC_TREE_STATS)
+	/**
+	 * The counters a tree keeps when NWACC_TREE_STATS is defined. They are
+	 * relaxed atomics, so concurrent readers of a const tree can count
+	 * their lookups. A copied or moved tree starts counting from zero.
+	 *
+	 * NWACC_TREE_STATS changes the layout of every tree, so it has to be
+	 * defined the same way for the whole program.
+	 */
+	class tree_stats_recorder
+	{
+	public:
+		/**
+		 * Counts one operation, and the comparisons it makes, when it ends.
+		 * One in NWACC_TREE_STATS_SAMPLE_INTERVAL operations is also timed.
+		 */
+		class operation_scope
+		{
+		public:
+			operation_scope(const tree_stats_recorder &recorder, tree_operation which) :
+				recorder{ &recorder }, which{ which }, comparisons{ 0 }, sampled{ false }
+			{
+				auto count = recorder.counter(which).fetch_add(1, std::memory_order_relaxed);
+				if ((count & (NWACC_TREE_STATS_SAMPLE_INTERVAL - 1)) == 0)
+				{
+					this->sampled = true;
+					this->start = std::chrono::steady_clock::now();
+				} // else, not timed, do_nothing();
+			}
+
+			operation_scope(operation_scope &&rhs) noexcept :
+				recorder{ rhs.recorder }, which{ rhs.which }, comparisons{ rhs.comparisons }, sampled{ rhs.sampled }, start{ rhs.start }
+			{
+				rhs.recorder = nullptr;
+			}
+
+			operation_scope(const operation_scope &rhs) = delete;
+			operation_scope &operator=(const operation_scope &rhs) = delete;
+
+			~operation_scope()
+			{
+				if (this->recorder == nullptr)
+				{
+					return;
+				} // else, this scope is still live.
+
+				if (this->comparisons != 0)
+				{
+					this->recorder->comparisons.fetch_add(this->comparisons, std::memory_order_relaxed);
+				} // else, nothing compared, do_nothing();
+
+				if (this->sampled)
+				{
+					auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - this->start).count();
+					this->recorder->latency(this->which).add(static_cast<std::uint64_t>(elapsed));
+				} // else, not timed, do_nothing();
+			}
+
+			/**
+			 * Count a key comparison and pass its result through.
+			 */
+			bool counted(bool result)
+			{
+				this->comparisons++;
+				return result;
+			}
+
+		private:
+			const tree_stats_recorder *recorder;
+			tree_operation which;
+			std::uint64_t comparisons;
+			bool sampled;
+			std::chrono::steady_clock::time_point start;
+		};
+
+		tree_stats_recorder() {}
+
+		tree_stats_recorder(const tree_stats_recorder &) {}
+
+		tree_stats_recorder &operator=(const tree_stats_recorder &)
+		{
+			return *this;
+		}
+
+		operation_scope record(tree_operation which) const
+		{
+			return operation_scope(*this, which);
+		}
+
+		/**
+		 * Count a batch of operations at once, without timing them.
+		 */
+		void record_batch(tree_operation which, std::uint64_t count, std::uint64_t comparisons) const
+		{
+			this->counter(which).fetch_add(count, std::memory_order_relaxed);
+			this->comparisons.fetch_add(comparisons, std::memory_order_relaxed);
+		}
+
+		void record_allocation() const
+		{
+			this->allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void record_deallocation() const
+		{
+			this->deallocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Copy the counters into a snapshot.
+		 */
+		void collect(tree_stats &stats) const
+		{
+			stats.counters_enabled = true;
+			stats.inserts = this->inserts.load(std::memory_order_relaxed);
+			stats.removes = this->removes.load(std::memory_order_relaxed);
+			stats.lookups = this->lookups.load(std::memory_order_relaxed);
+			stats.lookup_comparisons = this->comparisons.load(std::memory_order_relaxed);
+			stats.allocations = this->allocations.load(std::memory_order_relaxed);
+			stats.deallocations = this->deallocations.load(std::memory_order_relaxed);
+			this->insert_latency.collect(stats.insert_latency);
+			this->remove_latency.collect(stats.remove_latency);
+			this->lookup_latency.collect(stats.lookup_latency);
+		}
+
+	private:
+		struct latency_recorder
+		{
+			std::atomic<std::uint64_t> samples{ 0 };
+			std::atomic<std::uint64_t> total_nanoseconds{ 0 };
+			std::atomic<std::uint64_t> max_nanoseconds{ 0 };
+			std::atomic<std::uint64_t> buckets[latency_summary::kBuckets] = {};
+
+			void add(std::uint64_t nanoseconds)
+			{
+				std::size_t bucket = 0;
+				while (bucket + 1 < latency_summary::kBuckets && nanoseconds >= (std::uint64_t{ 1 } << bucket))
+				{
+					bucket++;
+				}
+				this->buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+				this->samples.fetch_add(1, std::memory_order_relaxed);
+				this->total_nanoseconds.fetch_add(nanoseconds, std::memory_order_relaxed);
+				auto longest = this->max_nanoseconds.load(std::memory_order_relaxed);
+				while (nanoseconds > longest && !this->max_nanoseconds.compare_exchange_weak(longest, nanoseconds, std::memory_order_relaxed))
+				{
+					// another sample raced us, try again against it. do_nothing();
+				}
+			}
+
+			void collect(latency_summary &summary) const
+			{
+				summary.samples = this->samples.load(std::memory_order_relaxed);
+				summary.total_nanoseconds = this->total_nanoseconds.load(std::memory_order_relaxed);
+				summary.max_nanoseconds = this->max_nanoseconds.load(std::memory_order_relaxed);
+				for (std::size_t bucket = 0; bucket < latency_summary::kBuckets; bucket++)
+				{
+					summary.buckets[bucket] = this->buckets[bucket].load(std::memory_order_relaxed);
+				}
+			}
+		};
+
+		mutable std::atomic<std::uint64_t> inserts{ 0 };
+		mutable std::atomic<std::uint64_t> removes{ 0 };
+		mutable std::atomic<std::uint64_t> lookups{ 0 };
+		mutable std::atomic<std::uint64_t> comparisons{ 0 };
+		mutable std::atomic<std::uint64_t> allocations{ 0 };
+		mutable std::atomic<std::uint64_t> deallocations{ 0 };
+		mutable latency_recorder insert_latency;
+		mutable latency_recorder remove_latency;
+		mutable latency_recorder lookup_latency;
+
+		std::atomic<std::uint64_t> &counter(tree_operation which) const
+		{
+			return which == tree_operation::insert ? this->inserts
+				: which == tree_operation::remove ? this->removes : this->lookups;
+		}
+
+		latency_recorder &latency(tree_operation which) const
+		{
+			return which == tree_operation::insert ? this->insert_latency
+				: which == tree_operation::remove ? this->remove_latency : this->lookup_latency;
+		}
+	};
+#else
+	/**
+	 * Without NWACC_TREE_STATS a tree keeps no counters: this is empty, and
+	 * every call on it compiles away.
+	 */
+	class tree_stats_recorder
+	{
+	public:
+		class operation_scope
+		{
+		public:
+			// user provided, so an unused scope draws no warning.
+			operation_scope() {}
+
+			~operation_scope() {}
+
+			bool counted(bool result)
+			{
+				return result;
+			}
+		};
+
+		operation_scope record(tree_operation) const
+		{
+			return operation_scope();
+		}
+
+		void record_batch(tree_operation, std::uint64_t, std::uint64_t) const {}
+
+		void record_allocation() const {}
+
+		void record_deallocation() const {}
+
+		void collect(tree_stats &stats) const
+		{
+			stats.counters_enabled = false;
+		}
+	};
+#endif
+}
+
+#endif // TREE_STATS_H_
@@ -0,0 +1,642 @@
+#ifndef UNROLLED_LIST_H_
+#define UNROLLED_LIST_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "node_pool.h"
+
+namespace nwacc
+{
+	// the bytes each chunk aims for, four cache lines on most machines.
+	const std::size_t kUnrolledChunkBytes = 256;
+
+	/**
+	 * How many elements of T fill a chunk of kUnrolledChunkBytes, less
+	 * its links and count, but never fewer than four.
+	 */
+	template <typename T>
+	constexpr int unrolled_chunk_capacity()
+	{
+		return (kUnrolledChunkBytes - 3 * sizeof(void *)) / sizeof(T) < 4 ?
+			4 : static_cast<int>((kUnrolledChunkBytes - 3 * sizeof(void *)) / sizeof(T));
+	}
+
+	/**
+	 * A doubly linked list that keeps up to ChunkCapacity elements in each
+	 * node (an unrolled linked list). Walking the list touches one node per
+	 * chunk rather than one per element, and the links are paid for once
+	 * per chunk, so a list of ints costs a few bytes per element instead of
+	 * the 16 or more a linked_list spends on its two pointers.
+	 *
+	 * The API is the one linked_list has. Inserting into a chunk shifts the
+	 * elements after it along, and a full chunk is split in two, so an
+	 * insert invalidates the iterators into the chunk it lands in. An erase
+	 * invalidates the iterators into its chunk and, when the chunk is left
+	 * less than a quarter full and it fits, the next chunk, which is folded
+	 * into it. Iterators into any other chunk stay valid.
+	 *
+	 * The list ends at a sentinel held in the list object itself, so an
+	 * empty list allocates nothing. Chunks are obtained from the Allocator
+	 * rebound to the chunk type.
+	 */
+	template <typename T, int ChunkCapacity = unrolled_chunk_capacity<T>(), typename Allocator = std::allocator<T>>
+	class unrolled_list
+	{
+	private:
+		struct links
+		{
+			links *previous;
+			links *next;
+		};
+
+		struct chunk : links
+		{
+			int count;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type slots[ChunkCapacity];
+
+			T *data()
+			{
+				return reinterpret_cast<T *>(this->slots);
+			}
+		};
+	public:
+		class const_iterator
+		{
+		public:
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = const T *;
+			using reference = const T &;
+
+			const_iterator() : current{ nullptr }, index{ 0 } {}
+
+			const T &operator*() const
+			{
+				return this->retrieve();
+			}
+
+			const T *operator->() const
+			{
+				return &this->retrieve();
+			}
+
+			const_iterator &operator++()
+			{
+				this->increment();
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			const_iterator &operator--()
+			{
+				this->decrement();
+				return *this;
+			}
+
+			const_iterator operator--(int)
+			{
+				auto old = *this;
+				--(*this);
+				return old;
+			}
+
+			bool operator==(const const_iterator &rhs) const
+			{
+				return this->current == rhs.current && this->index == rhs.index;
+			}
+
+			bool operator!=(const const_iterator &rhs) const
+			{
+				return !(*this == rhs);
+			}
+
+		protected:
+			links *current;
+			int index;
+
+			T &retrieve() const
+			{
+				return static_cast<chunk *>(this->current)->data()[this->index];
+			}
+
+			// step within the chunk, then on to the start of the next.
+			void increment()
+			{
+				if (++this->index == static_cast<chunk *>(this->current)->count)
+				{
+					this->current = this->current->next;
+					this->index = 0;
+				} // else, still in this chunk, do_nothing();
+			}
+
+			void decrement()
+			{
+				if (this->index == 0)
+				{
+					this->current = this->current->previous;
+					this->index = static_cast<chunk *>(this->current)->count;
+				} // else, still in this chunk, do_nothing();
+
+				this->index--;
+			}
+
+			const_iterator(links *current, int index) : current{ current }, index{ index } {}
+
+			friend class unrolled_list;
+		};
+
+		class iterator : public const_iterator
+		{
+		public:
+			using pointer = T *;
+			using reference = T &;
+
+			iterator() {}
+
+			T &operator*()
+			{
+				return const_iterator::retrieve();
+			}
+
+			const T &operator*() const
+			{
+				return const_iterator::operator*();
+			}
+
+			T *operator->()
+			{
+				return &const_iterator::retrieve();
+			}
+
+			iterator &operator++()
+			{
+				this->increment();
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				auto old = *this;
+				++(*this);
+				return old;
+			}
+
+			iterator &operator--()
+			{
+				this->decrement();
+				return *this;
+			}
+
+			iterator operator--(int)
+			{
+				auto old = *this;
+				--(*this);
+				return old;
+			}
+		protected:
+			iterator(links *current, int index) : const_iterator{ current, index } {}
+
+			friend class unrolled_list;
+		};
+
+		unrolled_list()
+		{
+			this->init();
+		}
+
+		explicit unrolled_list(const Allocator &allocator) : allocator{ allocator }
+		{
+			this->init();
+		}
+
+		unrolled_list(const unrolled_list &rhs)
+			: allocator{ chunk_traits::select_on_container_copy_construction(rhs.allocator) }
+		{
+			this->init();
+			try
+			{
+				for (auto &value : rhs)
+				{
+					this->push_back(value);
+				}
+			}
+			catch (...)
+			{
+				this->clear();
+				throw;
+			}
+		}
+
+		unrolled_list(unrolled_list &&rhs) : allocator{ rhs.allocator }
+		{
+			this->init();
+			this->take(rhs);
+		}
+
+		~unrolled_list()
+		{
+			if (std::is_trivially_destructible<T>::value && releases_in_bulk<chunk_allocator>::on_destruction(this->allocator))
+			{
+				// the allocator gives back every chunk at once when it goes away.
+				return;
+			} // else, every chunk has to be destroyed on its own.
+
+			this->clear();
+		}
+
+		unrolled_list &operator=(unrolled_list &&rhs)
+		{
+			if (this != &rhs)
+			{
+				this->clear();
+				std::swap(this->allocator, rhs.allocator);
+				this->take(rhs);
+			} // else, self assignment, do_nothing();
+			return *this;
+		}
+
+		unrolled_list &operator=(const unrolled_list &rhs)
+		{
+			auto copy = rhs;
+			*this = std::move(copy);
+			return *this;
+		}
+
+		iterator begin()
+		{
+			return iterator(this->sentinel.next, 0);
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this->sentinel.next, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(&this->sentinel, 0);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(const_cast<links *>(&this->sentinel), 0);
+		}
+
+		int size() const
+		{
+			return this->my_size;
+		}
+
+		bool is_empty() const
+		{
+			return this->size() == 0;
+		}
+
+		void clear()
+		{
+			auto *current = this->sentinel.next;
+			while (current != &this->sentinel)
+			{
+				auto *next = current->next;
+				this->destroy_chunk(static_cast<chunk *>(current));
+				current = next;
+			}
+			this->init();
+		}
+
+		T &front()
+		{
+			return *begin();
+		}
+
+		const T &front() const
+		{
+			return *begin();
+		}
+
+		T &back()
+		{
+			return *--end();
+		}
+
+		const T &back() const
+		{
+			return *--end();
+		}
+
+		void push_front(const T &value)
+		{
+			this->insert(this->begin(), value);
+		}
+
+		void push_back(const T &value)
+		{
+			this->insert(this->end(), value);
+		}
+
+		void push_front(T &&value)
+		{
+			this->insert(this->begin(), std::move(value));
+		}
+
+		void push_back(T &&value)
+		{
+			this->insert(this->end(), std::move(value));
+		}
+
+		void pop_front()
+		{
+			this->erase(this->begin());
+		}
+
+		void pop_back()
+		{
+			this->erase(--this->end());
+		}
+
+		// insert a value BEFORE iterator, returning where it went.
+		iterator insert(iterator position, const T &value)
+		{
+			return this->emplace(position, value);
+		}
+
+		iterator insert(iterator position, T &&value)
+		{
+			return this->emplace(position, std::move(value));
+		}
+
+		/**
+		 * Construct a value in place BEFORE iterator. At the ends of the
+		 * list a full chunk gets a new neighbour rather than being split,
+		 * so a list built with push_back or push_front has full chunks.
+		 */
+		template <typename... Args>
+		iterator emplace(iterator position, Args &&... args)
+		{
+			chunk *target;
+			int index;
+			if (position.current == &this->sentinel)
+			{
+				if (this->is_empty())
+				{
+					target = this->link_chunk_before(&this->sentinel);
+					return this->construct_at(target, 0, std::forward<Args>(args)...);
+				} // else, append to the last chunk.
+
+				target = static_cast<chunk *>(this->sentinel.previous);
+				index = target->count;
+			}
+			else
+			{
+				target = static_cast<chunk *>(position.current);
+				index = position.index;
+			}
+
+			if (target->count < ChunkCapacity)
+			{
+				return this->construct_at(target, index, std::forward<Args>(args)...);
+			} // else, the chunk is full.
+
+			if (index == target->count)
+			{
+				// after the last element: start the next chunk.
+				auto *next = this->link_chunk_before(target->next);
+				return this->construct_at(next, 0, std::forward<Args>(args)...);
+			} // else, not at the end of the chunk.
+
+			if (index == 0)
+			{
+				auto *previous = target->previous;
+				if (previous == &this->sentinel || static_cast<chunk *>(previous)->count == ChunkCapacity)
+				{
+					previous = this->link_chunk_before(target);
+				} // else, there is room at the end of the previous chunk.
+
+				auto *before = static_cast<chunk *>(previous);
+				return this->construct_at(before, before->count, std::forward<Args>(args)...);
+			} // else, in the middle of a full chunk.
+
+			// the arguments may refer to an element the split is about to
+			// move, so build the value first.
+			T value(std::forward<Args>(args)...);
+			auto *upper = this->split(target);
+			if (index <= target->count)
+			{
+				return this->construct_at(target, index, std::move(value));
+			}
+			return this->construct_at(upper, index - target->count, std::move(value));
+		}
+
+		/**
+		 * Remove the value AT iterator, returning the position of the value
+		 * that followed it.
+		 */
+		iterator erase(iterator position)
+		{
+			auto *target = static_cast<chunk *>(position.current);
+			auto *data = target->data();
+			auto index = position.index;
+			std::move(data + index + 1, data + target->count, data + index);
+			target->count--;
+			data[target->count].~T();
+			this->my_size--;
+
+			if (target->count == 0)
+			{
+				auto *next = target->next;
+				this->unlink_chunk(target);
+				return iterator(next, 0);
+			} // else, the chunk still has values.
+
+			if (std::is_nothrow_move_constructible<T>::value &&
+				target->count < ChunkCapacity / 4 && target->next != &this->sentinel &&
+				target->count + static_cast<chunk *>(target->next)->count <= ChunkCapacity)
+			{
+				this->merge_next(target);
+			} // else, leave the chunk as it is, do_nothing();
+
+			if (index == target->count)
+			{
+				return iterator(target->next, 0);
+			}
+			return iterator(target, index);
+		}
+
+	private:
+
+		using chunk_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<chunk>;
+		using chunk_traits = std::allocator_traits<chunk_allocator>;
+
+		int my_size;
+		links sentinel;
+		chunk_allocator allocator;
+
+		void init()
+		{
+			this->my_size = 0;
+			this->sentinel.previous = &this->sentinel;
+			this->sentinel.next = &this->sentinel;
+		}
+
+		/**
+		 * Move every chunk of rhs over to this empty list, pointing the
+		 * first and last chunks at this list's sentinel.
+		 */
+		void take(unrolled_list &rhs)
+		{
+			if (rhs.is_empty())
+			{
+				return;
+			} // else, there are chunks to move.
+
+			this->my_size = rhs.my_size;
+			this->sentinel.next = rhs.sentinel.next;
+			this->sentinel.previous = rhs.sentinel.previous;
+			this->sentinel.next->previous = &this->sentinel;
+			this->sentinel.previous->next = &this->sentinel;
+			rhs.init();
+		}
+
+		// an empty chunk, linked in before next.
+		chunk *link_chunk_before(links *next)
+		{
+			auto *current = chunk_traits::allocate(this->allocator, 1);
+			current->count = 0;
+			current->next = next;
+			current->previous = next->previous;
+			next->previous->next = current;
+			next->previous = current;
+			return current;
+		}
+
+		void unlink_chunk(chunk *current)
+		{
+			current->previous->next = current->next;
+			current->next->previous = current->previous;
+			chunk_traits::deallocate(this->allocator, current, 1);
+		}
+
+		void destroy_chunk(chunk *current)
+		{
+			auto *data = current->data();
+			for (auto index = 0; index < current->count; index++)
+			{
+				data[index].~T();
+			}
+			chunk_traits::deallocate(this->allocator, current, 1);
+		}
+
+		/**
+		 * Construct the value at the end of a chunk with room, then rotate
+		 * it into place. A chunk that was made for it and is still empty
+		 * is unlinked again if the construction throws.
+		 */
+		template <typename... Args>
+		iterator construct_at(chunk *target, int index, Args &&... args)
+		{
+			auto *data = target->data();
+			try
+			{
+				::new (static_cast<void *>(data + target->count)) T(std::forward<Args>(args)...);
+			}
+			catch (...)
+			{
+				if (target->count == 0)
+				{
+					this->unlink_chunk(target);
+				} // else, the chunk holds other values, do_nothing();
+				throw;
+			}
+
+			target->count++;
+			this->my_size++;
+			std::rotate(data + index, data + target->count - 1, data + target->count);
+			return iterator(target, index);
+		}
+
+		/**
+		 * Move the upper half of a full chunk into a new chunk after it.
+		 */
+		chunk *split(chunk *lower)
+		{
+			auto *upper = this->link_chunk_before(lower->next);
+			this->relocate(lower, ChunkCapacity / 2, upper);
+			return upper;
+		}
+
+		/**
+		 * Fold the next chunk into this one, which has room for it. Only
+		 * called when moving an element cannot throw.
+		 */
+		void merge_next(chunk *lower)
+		{
+			auto *upper = static_cast<chunk *>(lower->next);
+			auto *from = upper->data();
+			auto *to = lower->data() + lower->count;
+			for (auto index = 0; index < upper->count; index++)
+			{
+				::new (static_cast<void *>(to + index)) T(std::move(from[index]));
+				from[index].~T();
+			}
+			lower->count += upper->count;
+			upper->count = 0;
+			this->unlink_chunk(upper);
+		}
+
+		/**
+		 * Move the values of from past keep into the empty chunk to. When
+		 * moving can throw they are copied, and a failed copy leaves from
+		 * as it was and unlinks to.
+		 */
+		void relocate(chunk *from, int keep, chunk *to)
+		{
+			auto *source = from->data();
+			auto *destination = to->data();
+			try
+			{
+				for (auto index = keep; index < from->count; index++)
+				{
+					::new (static_cast<void *>(destination + to->count)) T(std::move_if_noexcept(source[index]));
+					to->count++;
+				}
+			}
+			catch (...)
+			{
+				this->discard_chunk(to);
+				throw;
+			}
+
+			for (auto index = keep; index < from->count; index++)
+			{
+				source[index].~T();
+			}
+			from->count = keep;
+		}
+
+		// destroy a chunk's values, then unlink it.
+		void discard_chunk(chunk *current)
+		{
+			auto *data = current->data();
+			for (auto index = 0; index < current->count; index++)
+			{
+				data[index].~T();
+			}
+			current->count = 0;
+			this->unlink_chunk(current);
+		}
+	};
+}
+
+#endif // UNROLLED_LIST_H_